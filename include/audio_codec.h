@@ -0,0 +1,46 @@
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact encodings for uploading and archiving utterances.
+// IMA-ADPCM is 4 bits per sample (4:1 against 16-bit PCM); halving the
+// rate to 8 kHz doubles that, at the cost of everything above 4 kHz.
+enum AudioFormat {
+    AUDIO_FORMAT_PCM16,        // 16 kHz 16-bit WAV, 32 KB/s
+    AUDIO_FORMAT_PCM16_8K,     // 8 kHz 16-bit WAV, 16 KB/s
+    AUDIO_FORMAT_ADPCM,        // 16 kHz IMA-ADPCM WAV, ~8 KB/s
+    AUDIO_FORMAT_ADPCM_8K      // 8 kHz IMA-ADPCM WAV, ~4 KB/s
+};
+
+#define ADPCM_BLOCK_ALIGN 256                                   // bytes per mono block
+#define ADPCM_SAMPLES_PER_BLOCK ((ADPCM_BLOCK_ALIGN - 4) * 2 + 1) // 505
+#define ADPCM_WAV_HEADER_SIZE 60                                // RIFF + fmt(20) + fact + data
+
+struct AdpcmState {
+    int16_t predictor;
+    uint8_t step_index;
+};
+
+// One WAV-layout block: 4-byte header (first sample, step index) followed
+// by samples - 1 nibbles, low nibble first. Encodes up to
+// ADPCM_SAMPLES_PER_BLOCK samples; a short block is padded to full size.
+void adpcm_encode_block(const int16_t* pcm, size_t samples, AdpcmState& state, uint8_t* block);
+size_t adpcm_decode_block(const uint8_t* block, size_t block_bytes, int16_t* pcm);
+
+// 2:1 decimation through a 27-tap half-band low-pass; only the centre tap
+// plus 7 folded symmetric pairs are evaluated (8 multiplies per output).
+// out holds samples / 2 values.
+size_t audio_decimate_2x(const int16_t* in, size_t samples, int16_t* out);
+
+// Encodes mono 16-bit PCM as a WAV file in the requested format
+std::vector<uint8_t> audio_encode_wav(const int16_t* pcm, size_t samples, uint32_t sample_rate, AudioFormat format);
+
+// Re-encodes a 16-bit PCM WAV (as produced by AudioManager); other input is returned unchanged
+std::vector<uint8_t> audio_transcode_wav(const std::vector<uint8_t>& wav, AudioFormat format);
+
+const char* audio_format_name(AudioFormat format);
+
+#endif // AUDIO_CODEC_H
@@ -0,0 +1,27 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Gain as a Q15 mantissa scaled by 2^shift: out = sat16(round(x * q15 * 2^shift / 32768))
+struct DspGain {
+    int16_t q15;
+    uint8_t shift;
+};
+
+DspGain dsp_gain_from_float(float gain);
+
+// Saturating in-place gain
+void dsp_apply_gain(int16_t* samples, size_t count, DspGain gain);
+
+// Exact statistics, accumulated in 64 bits
+int64_t dsp_sum_squares(const int16_t* samples, size_t count);
+float dsp_rms(const int16_t* samples, size_t count);
+int32_t dsp_peak(const int16_t* samples, size_t count);
+int64_t dsp_sum(const int16_t* samples, size_t count);
+
+// Subtracts the buffer mean with saturation, returns the removed offset
+int16_t dsp_remove_dc(int16_t* samples, size_t count);
+
+#endif // AUDIO_DSP_H
@@ -0,0 +1,11 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, reflected, as used by zip and PNG). Pass the previous
+// result to continue over several buffers; start from 0.
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
+#endif // CRC32_H
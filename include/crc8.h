@@ -0,0 +1,12 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-8 (polynomial 0x07, as used by SMBus PEC). Unlike an additive sum it
+// notices reordered bytes; bursts of up to 8 bits are always caught.
+// Pass the previous result to continue over several buffers; start from 0.
+uint8_t crc8_update(uint8_t crc, const void* data, size_t length);
+
+#endif // CRC8_H
@@ -1,11 +1,100 @@
 #ifndef DISPLAY_MANAGER_H
 #define DISPLAY_MANAGER_H
 
+#include <cstddef>
 #include <cstdint>
 
+// Retained-mode screen. Widgets keep the text and colour on the panel;
+// setting them only marks what changed, and render() pushes just those
+// rectangles. Text is drawn opaque over its own cells, so nothing is
+// cleared first and nothing flickers; only the strip an old, longer text
+// leaves behind is filled.
+//
+// The large number line and the banner are not rasterized per frame.
+// Glyphs "#0-9" and the two banner lines are prerendered once at boot; a
+// number is composited into an off-screen strip by copying glyph rows
+// and pushed to the panel by DMA while the CPU carries on. The next
+// render, or display_flush(), waits for the transfer before reusing the
+// strip.
+
+#define DISPLAY_GLYPH_WIDTH 6       // built-in font at text size 1
+#define DISPLAY_GLYPH_HEIGHT 8
+#define DISPLAY_TEXT_MAX 24
+#define DISPLAY_BACKGROUND 0x0000   // black, RGB565
+#define DISPLAY_BANNER_COLOR 0xFFFF
+#define DISPLAY_BANNER_SIZE 2
+#define DISPLAY_BANNER_CHARS 9      // "CLOAKROOM"
+
+#define DISPLAY_SPRITE_GLYPHS "#0123456789"
+#define DISPLAY_NUMBER_SIZE 3
+#define DISPLAY_NUMBER_CELLS 6      // longest sprite text the strip holds
+#define DISPLAY_CELL_WIDTH (DISPLAY_GLYPH_WIDTH * DISPLAY_NUMBER_SIZE)
+#define DISPLAY_CELL_HEIGHT (DISPLAY_GLYPH_HEIGHT * DISPLAY_NUMBER_SIZE)
+
+enum DisplayWidgetId : uint8_t {
+    DISPLAY_BANNER,             // "CLOAKROOM"
+    DISPLAY_BANNER_SUB,         // "VOICE ID"
+    DISPLAY_STATUS,
+    DISPLAY_NUMBER,             // large: assignment number or hint
+    DISPLAY_WIDGETS
+};
+
+struct DisplayRect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+struct DisplayWidget {
+    int16_t x;
+    int16_t y;
+    uint8_t text_size;
+    uint16_t color;
+    char text[DISPLAY_TEXT_MAX];
+    DisplayRect drawn;          // area the text covers on the panel now
+    bool dirty;
+};
+
+// Where each widget sits; the two mains lay the screen out slightly apart
+struct DisplayLayout {
+    int16_t x;
+    int16_t banner_y;
+    int16_t banner_sub_y;
+    int16_t status_y;
+    int16_t number_y;
+};
+
+class DisplayScreen {
+public:
+    DisplayScreen();
+
+    void place(DisplayWidgetId id, int16_t x, int16_t y, uint8_t text_size);
+    void setText(DisplayWidgetId id, const char* text, uint16_t color);
+    // Redraw everything, e.g. after the panel was cleared behind our back
+    void invalidate();
+
+    // Pushes dirty widgets; returns the pixels written
+    size_t render();
+
+    const DisplayWidget& widget(DisplayWidgetId id) const { return widgets[id]; }
+
+private:
+    DisplayWidget widgets[DISPLAY_WIDGETS];
+};
+
+DisplayScreen& display_screen();
+
+// Prerenders the sprites, places the widgets and draws the banner once
+void display_begin(const DisplayLayout& layout);
+// Waits for a pending DMA push; call before drawing on the panel directly
+void display_flush();
+// Status line and the large line under it; unchanged parts are not redrawn
+void display_show_status(const char* status, uint16_t color, const char* extra = "");
+
 // Display functions
 void show_assignment_number(uint16_t number);
 void show_recognition_success(uint16_t number);
 void show_rejection_feedback();
 
-#endif // DISPLAY_MANAGER_H
\ No newline at end of file
+#endif // DISPLAY_MANAGER_H
@@ -0,0 +1,60 @@
+#ifndef EXPIRY_WHEEL_H
+#define EXPIRY_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#define EXPIRY_TICK_SECONDS 60                 // level 0 resolution
+#define EXPIRY_WHEEL_BITS 6
+#define EXPIRY_WHEEL_SIZE (1 << EXPIRY_WHEEL_BITS)
+#define EXPIRY_WHEEL_MASK (EXPIRY_WHEEL_SIZE - 1)
+#define EXPIRY_UNSCHEDULED 0xFF
+
+typedef std::function<void(int16_t slot)> ExpiryCallback;
+
+// Two-level hierarchical timing wheel over profile slots.
+//
+//   level 0: 64 buckets of one tick (1 min)
+//   level 1: 64 buckets of 64 ticks (~68 h span)
+//
+// Buckets are intrusive doubly-linked lists threaded through per-slot
+// arrays, so scheduling and cancelling are O(1) and need no allocation.
+// A level 1 bucket is cascaded into level 0 once every 64 ticks; each
+// entry is moved at most once per level, which keeps advance() O(1)
+// amortized per tick plus the entries that actually expire.
+class ExpiryWheel {
+public:
+    explicit ExpiryWheel(size_t max_slots);
+
+    void start(uint32_t now_seconds);
+    void clear();
+    void schedule(int16_t slot, uint32_t deadline_seconds);
+    void cancel(int16_t slot);
+    bool isScheduled(int16_t slot) const { return bucket_of[slot] != EXPIRY_UNSCHEDULED; }
+
+    // Runs every tick up to now; expire is called with the slot already unlinked
+    size_t advance(uint32_t now_seconds, const ExpiryCallback& expire);
+
+    // End of shift: everything goes, whatever its deadline
+    size_t expireAll(const ExpiryCallback& expire);
+
+    size_t size() const { return scheduled; }
+
+private:
+    uint32_t current_tick;
+    size_t scheduled;
+
+    int16_t heads[2 * EXPIRY_WHEEL_SIZE];   // level 0 buckets, then level 1
+    std::vector<int16_t> next;
+    std::vector<int16_t> prev;
+    std::vector<uint8_t> bucket_of;
+    std::vector<uint32_t> deadline_tick;
+
+    void place(int16_t slot);
+    void link(int16_t slot, uint8_t bucket);
+    void unlink(int16_t slot);
+};
+
+#endif // EXPIRY_WHEEL_H
@@ -1,20 +1,113 @@
 #ifndef I2C_COMMUNICATION_H
 #define I2C_COMMUNICATION_H
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 
-#define I2C_BUFFER_SIZE 64
+// Frame on the wire: length | type | fragment | sequence | payload[length] | crc8.
+// The CRC covers everything before it. Only the used bytes are sent, and
+// the controller reads a frame's header before the rest of it, so a
+// two-byte command costs 7 bytes written plus a 5-byte ACK read on the bus
+// instead of a fixed 66 written.
+//
+// Frames the controller writes carry the message's sequence number; frames
+// the peripheral answers with carry the last sequence it accepted, which
+// acknowledges everything up to it.
+#define I2C_FRAME_HEADER_SIZE 4
+#define I2C_FRAME_OVERHEAD (I2C_FRAME_HEADER_SIZE + 1)
+#define I2C_FRAME_MAX 64
+#define I2C_FRAME_PAYLOAD (I2C_FRAME_MAX - I2C_FRAME_OVERHEAD)
+
+// Fragment byte: index of this frame within the message, high bit set
+// while more frames follow
+#define I2C_FRAGMENT_MORE 0x80
+#define I2C_FRAGMENT_INDEX_MASK 0x7F
+
+// Larger payloads are split across frames and reassembled by the receiver
+#define I2C_BUFFER_SIZE 240
+#define I2C_MAX_FRAGMENTS ((I2C_BUFFER_SIZE + I2C_FRAME_PAYLOAD - 1) / I2C_FRAME_PAYLOAD)
+
+#define I2C_FEATHER_ADDRESS 0x42                  // Feather listens as a peripheral
+#define I2C_BUS_FREQUENCY 100000
+#define I2C_INBOX_MESSAGES 16
+
+// Controller sends are queued and drained by a bus task; up to
+// I2C_ACK_WINDOW messages may be on the wire unacknowledged
+#define I2C_SEND_QUEUE 16
+#define I2C_ACK_WINDOW 4
+#define I2C_ACK_POLL_MS 20          // read back for an ACK this soon after a send
+#define I2C_IDLE_POLL_MS 200        // read back at least this often for replies
+#define I2C_ACK_TIMEOUT_MS 250      // no ACK: go back and resend the window
+#define I2C_SEND_ATTEMPTS 4         // then the oldest message is given up on
+#define I2C_SERVICE_PERIOD_MS 20
+
+// Command 0 is "nothing to say": a peripheral with no reply queued answers
+// a read with an empty frame of it
+#define I2C_COMMAND_NONE 0x00
 
 struct I2CMessage {
     uint8_t command;
+    uint8_t sequence;               // filled in by the transport
+    uint8_t length;                 // payload bytes used in data
     uint8_t data[I2C_BUFFER_SIZE];
-    uint8_t checksum;
 };
 
+// Runs on the bus task once the peripheral acknowledged the message, or
+// with false once it was given up on
+typedef std::function<void(bool delivered)> I2CSendCallback;
+
+// Frame codec. i2c_encode_frame() writes fragment `index` of msg and
+// returns its size on the wire, or 0 past the last fragment.
+// i2c_frame_size() returns the size a frame claims from its length byte,
+// or 0 when that cannot be a frame.
+size_t i2c_fragment_count(const I2CMessage& msg);
+size_t i2c_encode_frame(const I2CMessage& msg, size_t index, uint8_t* frame);
+size_t i2c_frame_size(const uint8_t* frame, size_t available);
+bool i2c_frame_valid(const uint8_t* frame, size_t available);
+
+// Collects the frames of one message. Frames must arrive in order; a bad
+// CRC or a gap drops the partial message, and fragment 0 always starts over.
+class I2CReassembler {
+public:
+    I2CReassembler();
+
+    // True when frame completed a message, which is then in msg
+    bool feed(const uint8_t* frame, size_t available, I2CMessage& msg);
+    void reset();
+
+private:
+    I2CMessage partial;
+    uint8_t next_index;
+    bool active;
+};
+
+// The AtomS3R drives the bus; the Feather answers as a peripheral.
+// send_message()/receive_message() work in either role and never block on
+// the bus. A controller queues the message for the bus task and returns
+// false only when the queue is full; replies the task reads back wait for
+// receive_message(). A peripheral stages its reply for the controller's
+// next reads (counted as delivered at once) and drains messages the
+// controller wrote.
+bool i2c_begin_controller();
+bool i2c_begin_peripheral(uint8_t address = I2C_FEATHER_ADDRESS);
+
 // I2C functions
 void send_i2c_message();
-uint8_t calc_checksum(const I2CMessage& msg);
-bool send_message(const I2CMessage& msg);
+bool send_message(const I2CMessage& msg, I2CSendCallback done = nullptr);
 bool receive_message(I2CMessage& msg);
+size_t i2c_pending_sends();
+
+// One pass of the controller's bus work: transmit what the window allows,
+// read back ACKs and replies, resend on timeout. On ESP32 the bus task
+// runs it; host builds call it directly.
+void i2c_service(uint32_t now_ms);
+
+#ifndef ESP32
+// Host builds loop both roles back in one process; tests pick the side
+// the next send/receive acts as
+enum I2CRole : uint8_t { I2C_ROLE_CONTROLLER, I2C_ROLE_PERIPHERAL };
+void i2c_set_role(I2CRole role);
+#endif
 
-#endif // I2C_COMMUNICATION_H
\ No newline at end of file
+#endif // I2C_COMMUNICATION_H
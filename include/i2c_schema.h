@@ -0,0 +1,117 @@
+#ifndef I2C_SCHEMA_H
+#define I2C_SCHEMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "i2c_communication.h"
+
+// Typed layouts over I2CMessage payloads.
+//
+// A schema is a struct naming its command and its fixed fields, each field
+// placed right after the previous one:
+//
+//   struct PingSchema {
+//       static constexpr uint8_t command = 0x10;
+//       using Counter = I2CField<uint32_t, 0>;
+//       using Flags = I2CField<uint8_t, Counter::end>;
+//       static constexpr size_t size = Flags::end;
+//   };
+//
+// Anything after `size` is a variable tail the schema's owner parses.
+// Offsets and sizes are constants, so a field that runs past the schema
+// or a schema that cannot fit a message fails to compile, and every
+// accessor is a single load or store at a fixed offset.
+
+// Payloads are little endian; both chips and every host build are too,
+// so fields are copied as they lie
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "I2C fields are read in place");
+
+template <typename T, size_t Offset>
+struct I2CField {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "I2C fields are integers");
+    typedef T type;
+    static constexpr size_t offset = Offset;
+    static constexpr size_t end = Offset + sizeof(T);
+
+    // memcpy of a constant size: one (possibly unaligned) load or store
+    static T get(const uint8_t* payload) {
+        T value;
+        memcpy(&value, payload + Offset, sizeof(T));
+        return value;
+    }
+
+    static void put(uint8_t* payload, T value) {
+        memcpy(payload + Offset, &value, sizeof(T));
+    }
+};
+
+// Wire cost of a payload, frame headers and CRCs included
+constexpr size_t i2c_wire_size(size_t payload) {
+    return payload == 0 ? I2C_FRAME_OVERHEAD
+                        : payload + (payload + I2C_FRAME_PAYLOAD - 1) / I2C_FRAME_PAYLOAD * I2C_FRAME_OVERHEAD;
+}
+
+template <typename Schema>
+struct I2CSchemaCheck {
+    static_assert(Schema::size <= I2C_BUFFER_SIZE, "schema does not fit an I2C message");
+    static_assert(Schema::command != I2C_COMMAND_NONE, "command 0 is reserved for empty replies");
+    static constexpr bool ok = true;
+};
+
+// Read-only view of a received message. Fields are read straight out of
+// the message buffer; nothing is copied until a field is asked for.
+template <typename Schema>
+class I2CView {
+public:
+    static_assert(I2CSchemaCheck<Schema>::ok, "");
+
+    explicit I2CView(const I2CMessage& msg) : message(msg) {}
+
+    // Right command and long enough for every fixed field
+    bool valid() const { return message.command == Schema::command && message.length >= Schema::size; }
+
+    template <typename Field>
+    typename Field::type get() const {
+        static_assert(Field::end <= Schema::size, "field lies outside the schema");
+        return Field::get(message.data);
+    }
+
+    const uint8_t* tail() const { return message.data + Schema::size; }
+    const uint8_t* end() const { return message.data + message.length; }
+
+private:
+    const I2CMessage& message;
+};
+
+// Fills a message in place: the constructor sets command and the fixed
+// length, set() stores fields, and appended tail bytes extend the length.
+template <typename Schema>
+class I2CBuilder {
+public:
+    static_assert(I2CSchemaCheck<Schema>::ok, "");
+
+    explicit I2CBuilder(I2CMessage& msg) : message(msg) {
+        message.command = Schema::command;
+        message.length = (uint8_t)Schema::size;
+    }
+
+    template <typename Field>
+    I2CBuilder& set(typename Field::type value) {
+        static_assert(Field::end <= Schema::size, "field lies outside the schema");
+        Field::put(message.data, value);
+        return *this;
+    }
+
+    // Tail bytes are written from tail() up to limit(); finish() records
+    // where they stopped
+    uint8_t* tail() { return message.data + Schema::size; }
+    uint8_t* limit() { return message.data + I2C_BUFFER_SIZE; }
+    void finish(const uint8_t* tail_end) { message.length = (uint8_t)(tail_end - message.data); }
+
+private:
+    I2CMessage& message;
+};
+
+#endif // I2C_SCHEMA_H
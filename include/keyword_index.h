@@ -0,0 +1,70 @@
+#ifndef KEYWORD_INDEX_H
+#define KEYWORD_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define KEYWORD_INDEX_EMPTY -1
+#define KEYWORD_INDEX_TOMBSTONE -2
+#define KEYWORD_INDEX_INITIAL_CAPACITY 64
+#define KEYWORD_INDEX_MAX_LOAD_PERCENT 75   // live entries + tombstones
+#define KEYWORD_INDEX_REHASH_STEP 8         // old-table positions migrated per operation
+#define KEYWORD_MAX_LENGTH 32
+
+// Keywords are compared after normalization: lower case, ASCII letters and
+// digits only, single spaces between words. "Helsinki  Winter." and
+// "helsinki winter" are the same keyword.
+size_t keyword_normalize(const char* keyword, char* out, size_t out_size);
+bool keyword_equal(const char* a, const char* b);
+uint32_t keyword_hash(const char* keyword); // FNV-1a of the normalized form
+
+struct KeywordIndexEntry {
+    uint32_t hash;
+    int16_t slot;   // profile table slot, or EMPTY / TOMBSTONE
+};
+
+// Open-addressing multimap from keyword hash to profile slot. Several
+// guests may share a keyword, so find() returns every slot with the hash
+// and the caller verifies the text. Growth is incremental: a new table is
+// allocated and the old one drains a few positions per operation, so no
+// single insert pays for a full rehash.
+class KeywordIndex {
+public:
+    explicit KeywordIndex(size_t initial_capacity = KEYWORD_INDEX_INITIAL_CAPACITY);
+    ~KeywordIndex();
+
+    KeywordIndex(const KeywordIndex&) = delete;
+    KeywordIndex& operator=(const KeywordIndex&) = delete;
+
+    bool insert(uint32_t hash, int16_t slot);
+    bool remove(uint32_t hash, int16_t slot);
+    size_t find(uint32_t hash, int16_t* slots, size_t max_slots) const;
+    void clear();
+
+    size_t size() const { return active.live + draining.live; }
+    size_t capacity() const { return active.capacity; }
+    bool isRehashing() const { return draining.entries != nullptr; }
+
+private:
+    struct Table {
+        KeywordIndexEntry* entries;
+        size_t capacity;    // power of two
+        size_t used;        // live entries + tombstones
+        size_t live;
+    };
+
+    Table active;
+    Table draining;
+    size_t drain_position;
+
+    static bool allocate(Table& table, size_t capacity);
+    static void release(Table& table);
+    static void place(Table& table, uint32_t hash, int16_t slot);
+    static bool erase(Table& table, uint32_t hash, int16_t slot);
+    static size_t collect(const Table& table, uint32_t hash, int16_t* slots, size_t max_slots);
+
+    bool startRehash();
+    void rehashStep(size_t positions);
+};
+
+#endif // KEYWORD_INDEX_H
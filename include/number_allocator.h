@@ -0,0 +1,64 @@
+#ifndef NUMBER_ALLOCATOR_H
+#define NUMBER_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define ASSIGNMENT_NUMBER_FIRST 1
+#define ASSIGNMENT_NUMBER_LAST 999
+#define ASSIGNMENT_ZONE_SIZE 100          // numbers per rack
+#define NUMBER_ALLOCATOR_CAPACITY 1024    // 32 words of 32 bits under one summary word
+#define NUMBER_ALLOCATOR_WORDS (NUMBER_ALLOCATOR_CAPACITY / 32)
+#define NUMBER_ALLOCATOR_MAX_ZONES 32
+
+enum NumberPolicy : uint8_t {
+    NUMBER_POLICY_LOWEST,     // lowest free number overall
+    NUMBER_POLICY_AFFINITY,   // requested zone first, then the nearest zones
+    NUMBER_POLICY_BALANCE     // zone with the most free numbers
+};
+
+// Assignment number pool. A set bit marks a number in use; a summary word
+// marks full bitmap words, so find-first-zero is two count-trailing-zeros
+// and allocate/release are O(1) whatever the occupancy. Zones are
+// contiguous number ranges (racks) of zone_size numbers.
+class NumberAllocator {
+public:
+    NumberAllocator(uint16_t first = ASSIGNMENT_NUMBER_FIRST, uint16_t last = ASSIGNMENT_NUMBER_LAST,
+                    uint16_t zone_size = ASSIGNMENT_ZONE_SIZE);
+
+    // Changes the range and releases every number
+    bool configure(uint16_t first, uint16_t last, uint16_t zone_size);
+    void reset();
+
+    void setPolicy(NumberPolicy value) { policy = value; }
+    NumberPolicy getPolicy() const { return policy; }
+
+    // Returns 0 when the pool (or, with no fallback left, the zone) is exhausted
+    uint16_t allocate(int zone = -1);
+    bool reserve(uint16_t number);
+    bool release(uint16_t number);
+    bool isAllocated(uint16_t number) const;
+
+    size_t available() const { return free_count; }
+    size_t zoneCount() const { return zones; }
+    int zoneOf(uint16_t number) const;
+    size_t zoneAvailable(int zone) const;
+
+private:
+    uint16_t first_number;
+    uint16_t last_number;
+    uint16_t zone_size;
+    size_t zones;
+    size_t free_count;
+    NumberPolicy policy;
+
+    uint32_t words[NUMBER_ALLOCATOR_WORDS];
+    uint32_t full_words;                        // bit w set: words[w] has no free bit
+    uint16_t zone_free[NUMBER_ALLOCATOR_MAX_ZONES];
+
+    int findFree(size_t low, size_t high) const;    // bit positions, inclusive
+    uint16_t take(int bit);
+    uint16_t allocateInZone(int zone);
+};
+
+#endif // NUMBER_ALLOCATOR_H
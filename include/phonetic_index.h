@@ -0,0 +1,52 @@
+#ifndef PHONETIC_INDEX_H
+#define PHONETIC_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define PHONETIC_KEY_SIZE 24
+#define PHONETIC_MAX_DISTANCE 1      // key edits tolerated by fuzzy lookups
+
+// Metaphone-style key of the normalized keyword, one code per word:
+// "Helsinki Winter." and "helsinky winter" both give "HLSNK WNTR"
+size_t keyword_phonetic_key(const char* keyword, char* out, size_t out_size);
+
+// Levenshtein distance, or limit + 1 as soon as it must exceed limit
+int keyword_edit_distance(const char* a, const char* b, int limit);
+
+// Same keyword as far as STT variation goes
+bool keyword_similar(const char* a, const char* b);
+
+struct PhoneticNode {
+    char key[PHONETIC_KEY_SIZE];
+    int16_t first_child;
+    int16_t next_sibling;
+    int16_t first_slot;     // chained through slot_next
+    uint8_t distance;       // edit distance to the parent key
+};
+
+// BK-tree over phonetic keys. Each node carries the profile slots whose
+// keyword has that key; a lookup only descends into children whose edge
+// distance is within max_distance of the probe's distance to the node,
+// so a handful of nodes are visited instead of every profile.
+class PhoneticIndex {
+public:
+    explicit PhoneticIndex(size_t max_slots);
+
+    bool insert(const char* keyword, int16_t slot);
+    bool remove(const char* keyword, int16_t slot);
+    size_t find(const char* keyword, int max_distance, int16_t* slots, size_t max_slots) const;
+    void clear();
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    std::vector<PhoneticNode> nodes;
+    std::vector<int16_t> slot_next;
+    mutable std::vector<int16_t> pending;   // search stack, kept to avoid reallocating
+
+    int findNode(const char* key) const;
+};
+
+#endif // PHONETIC_INDEX_H
@@ -0,0 +1,102 @@
+#ifndef PHRASE_CACHE_H
+#define PHRASE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Prerendered announcement prompts stored in flash. The container is
+//   header:  "SLPC" | version u16 | clip count u16 | sample rate u32 | index offset u32
+//   clips:   16-bit mono PCM, back to back
+//   index:   clip count x { key[24] | byte offset u32 | samples u32 }, sorted by key
+// Only the index is held in RAM; clips are read on demand.
+
+#ifdef ESP32
+#define PHRASE_CACHE_PATH "/littlefs/phrases.bin"
+#else
+#define PHRASE_CACHE_PATH "phrases.bin"
+#endif
+
+#define PHRASE_CACHE_VERSION 1
+#define PHRASE_KEY_SIZE 24
+#define PHRASE_CROSSFADE_SAMPLES 240    // 15 ms at 16 kHz
+#define PHRASE_SILENCE_THRESHOLD 300    // |sample| below this counts as silence when trimming
+#define PHRASE_MAX_KEYS 8               // prefix + up to "nine hundred ninety nine"
+
+enum PhrasePrefix {
+    PHRASE_STORED,              // "Your items are stored as number"
+    PHRASE_RETRIEVE,            // "Your items are number"
+    PHRASE_ALREADY_REGISTERED   // "You are already registered as number"
+};
+
+struct PhraseSource {
+    const char* key;
+    const char* text;           // what to synthesize when provisioning
+};
+
+struct PhraseEntry {
+    char key[PHRASE_KEY_SIZE];
+    uint32_t offset;
+    uint32_t samples;
+};
+
+// Every clip the announcements can reference
+const PhraseSource* phrase_vocabulary(size_t* count);
+
+// Clip keys for "<prefix> <number in words>", number 0-999; returns the key count
+size_t phrase_announcement_keys(PhrasePrefix prefix, uint16_t number, const char* keys[PHRASE_MAX_KEYS]);
+
+// Appends clip to out, overlapping the joint with a linear crossfade
+void phrase_crossfade_append(std::vector<int16_t>& out, const int16_t* clip, size_t samples,
+                             size_t fade_samples = PHRASE_CROSSFADE_SAMPLES);
+
+// Drops leading and trailing silence in place; returns the remaining length
+size_t phrase_trim_silence(int16_t* pcm, size_t samples, int16_t threshold = PHRASE_SILENCE_THRESHOLD);
+
+class PhraseCache {
+public:
+    PhraseCache();
+    ~PhraseCache();
+
+    bool open(const char* path = PHRASE_CACHE_PATH);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    size_t clipCount() const { return index.size(); }
+    uint32_t sampleRate() const { return sample_rate; }
+    bool contains(const char* key) const { return find(key) != nullptr; }
+
+    // Reads one clip and crossfades it onto out
+    bool appendClip(const char* key, std::vector<int16_t>& out);
+
+    // Assembles the full announcement into out (cleared first); false if any clip is missing
+    bool renderAnnouncement(PhrasePrefix prefix, uint16_t number, std::vector<int16_t>& out);
+
+private:
+    FILE* file;
+    uint32_t sample_rate;
+    std::vector<PhraseEntry> index;
+    std::vector<int16_t> scratch;
+
+    const PhraseEntry* find(const char* key) const;
+};
+
+// Writes a container clip by clip, so provisioning never holds more than one clip
+class PhraseCacheBuilder {
+public:
+    PhraseCacheBuilder();
+    ~PhraseCacheBuilder();
+
+    bool begin(const char* path, uint32_t sample_rate);
+    bool addClip(const char* key, const int16_t* pcm, size_t samples);
+    bool finish();
+    size_t clipCount() const { return entries.size(); }
+
+private:
+    FILE* file;
+    uint32_t sample_rate;
+    uint32_t data_end;
+    std::vector<PhraseEntry> entries;
+};
+
+#endif // PHRASE_CACHE_H
@@ -0,0 +1,53 @@
+#ifndef PITCH_TRACKER_H
+#define PITCH_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define PITCH_DECIMATION 2                                 // analyze at 8 kHz
+#define PITCH_SAMPLE_RATE (16000 / PITCH_DECIMATION)
+#define PITCH_MIN_HZ 60
+#define PITCH_MAX_HZ 400
+#define PITCH_MIN_LAG (PITCH_SAMPLE_RATE / PITCH_MAX_HZ)   // 20
+#define PITCH_MAX_LAG (PITCH_SAMPLE_RATE / PITCH_MIN_HZ)   // 133
+#define PITCH_WINDOW PITCH_MAX_LAG                         // integration window
+#define PITCH_HOP 80                                       // 10 ms at 8 kHz
+#define PITCH_BUFFER (PITCH_WINDOW + PITCH_MAX_LAG + 1)
+
+struct PitchStats {
+    float mean_hz;       // mean F0 over voiced frames, 0 if none
+    float variance_hz2;  // F0 variance over voiced frames
+    float voiced_ratio;  // voiced frames / analyzed frames
+    uint16_t frames;
+    uint16_t voiced_frames;
+};
+
+// Streaming YIN estimator. Samples are decimated on the way in and each
+// hop searches only the human voice lag range, stopping at the first
+// confident dip instead of scanning every lag.
+class PitchTracker {
+public:
+    PitchTracker();
+
+    void reset();
+    void pushSamples(const int16_t* samples, size_t count);
+
+    float lastPitch() const { return last_pitch; } // 0 when the last frame was unvoiced
+    PitchStats getStats() const;
+
+private:
+    int16_t buffer[PITCH_BUFFER]; // decimated, scaled samples, oldest first
+    size_t fill;
+    int16_t decimator_history[2];
+    bool decimator_phase;
+    float last_pitch;
+
+    uint16_t frames;
+    uint16_t voiced_frames;
+    float pitch_mean;
+    float pitch_m2;
+
+    void analyzeFrame();
+};
+
+#endif // PITCH_TRACKER_H
@@ -0,0 +1,110 @@
+#ifndef PROFILE_JOURNAL_H
+#define PROFILE_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "storage_manager.h"
+
+// Log-structured persistence for the profile table.
+//
+// Journal record:  magic u8 | type u8 | payload length u16 | sequence u32 | payload | crc32 u32
+// Snapshot file:   "SLSN" | version u16 | table slots u16 | profile count u32 | last sequence u32
+//                  | active profiles (slot + profile) | crc32 u32 over everything before it
+//
+// Records are keyed by table slot and are idempotent, so replaying the
+// journal over a snapshot taken while the table was changing converges
+// on the right state.
+
+#ifdef ESP32
+#define JOURNAL_PATH "/littlefs/profiles.log"
+#define SNAPSHOT_PATH "/littlefs/profiles.snap"
+#else
+#define JOURNAL_PATH "profiles.log"
+#define SNAPSHOT_PATH "profiles.snap"
+#endif
+
+#define JOURNAL_MAGIC 0xA5
+#define JOURNAL_HEADER_SIZE 8
+#define JOURNAL_TRAILER_SIZE 4
+#define JOURNAL_PROFILE_SIZE 81        // slot + serialized VoiceProfile
+#define JOURNAL_BATCH_BYTES 4096       // pending records before a forced flush
+#define JOURNAL_FLUSH_INTERVAL_MS 500
+#define JOURNAL_COMPACT_BYTES 65536    // journal size that triggers a snapshot
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 16
+
+enum JournalRecordType : uint8_t {
+    JOURNAL_ADD = 1,          // profile stored at slot
+    JOURNAL_DEACTIVATE = 2    // profile at slot marked inactive
+};
+
+struct JournalRecord {
+    JournalRecordType type;
+    uint32_t sequence;
+    uint16_t slot;
+    VoiceProfile profile;     // JOURNAL_ADD only
+};
+
+typedef std::function<void(const JournalRecord& record)> JournalApply;
+
+// Compaction reads the table through this: returns whether the slot is
+// active, and fills profile when it is non-null
+typedef std::function<bool(uint16_t slot, VoiceProfile* profile)> ProfileSource;
+
+// Fixed little-endian layout shared by journal and snapshot records
+void journal_encode_profile(uint8_t* out, uint16_t slot, const VoiceProfile& profile);
+void journal_decode_profile(const uint8_t* in, uint16_t* slot, VoiceProfile* profile);
+
+class ProfileJournal {
+public:
+    ProfileJournal();
+    ~ProfileJournal();
+
+    bool open(const char* journal_path = JOURNAL_PATH, const char* snapshot_path = SNAPSHOT_PATH);
+    void close();
+    bool isOpen() const { return opened; }
+
+    // Snapshot first, then journal records newer than it. A torn tail
+    // from a power cut is cut off so later appends land on a clean end.
+    size_t replay(const JournalApply& apply);
+
+    // Guest-facing path: encodes into RAM only
+    void appendAdd(uint16_t slot, const VoiceProfile& profile);
+    void appendDeactivate(uint16_t slot);
+
+    // Flash side; called from the background task
+    bool flush();
+    bool compactDue() const { return journal_bytes >= JOURNAL_COMPACT_BYTES; }
+
+    // Writes a snapshot of the table and restarts the journal
+    bool compact(const ProfileSource& source, int count);
+    uint16_t snapshotSlots() const { return snapshot_slots; }
+
+    size_t pendingBytes();
+    uint32_t journalBytes() const { return journal_bytes; }
+    uint32_t lastSequence() const { return sequence; }
+
+private:
+    bool opened;
+    char journal_path[48];
+    char snapshot_path[48];
+    FILE* journal;
+    uint32_t journal_bytes;
+    uint32_t sequence;
+    uint16_t snapshot_slots;
+
+    std::mutex pending_lock;    // guards pending and sequence
+    std::mutex file_lock;       // one flash writer at a time
+    std::vector<uint8_t> pending;
+
+    void appendRecord(JournalRecordType type, const uint8_t* payload, uint16_t length);
+    bool flushLocked();
+    bool loadSnapshot(const JournalApply& apply, uint32_t* snapshot_sequence);
+    size_t replayJournal(const JournalApply& apply, uint32_t after_sequence);
+};
+
+#endif // PROFILE_JOURNAL_H
@@ -0,0 +1,141 @@
+#ifndef PROFILE_REPLICATION_H
+#define PROFILE_REPLICATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "i2c_communication.h"
+#include "keyword_index.h"
+#include "storage_manager.h"
+
+// Change-log replication of the profile table, AtomS3R -> Feather.
+//
+// Every stored or retired profile becomes a delta with a sequence number.
+// Deltas are packed into batches of I2C messages; the Feather applies them
+// in sequence order and acknowledges the highest one it holds. A replica
+// that is new, rebooted or too far behind the log is rebuilt from a
+// snapshot of the active rows, then follows the deltas again.
+//
+//   DELTA_BATCH:    session u32 | first sequence u32 | count u8 | records
+//   SNAPSHOT_BEGIN: session u32 | sequence u32
+//   SNAPSHOT_ROWS:  session u32 | count u8 | records
+//   SNAPSHOT_END:   session u32 | sequence u32 | rows u16
+//   ACK:            session u32 | applied sequence u32 | state u8   (Feather -> AtomS3R)
+//
+//   record: type u8 | slot u16 [| number u16 | timestamp u32 | keyword length u8 | keyword]
+
+#define REPL_LOG_ENTRIES 256               // deltas kept for resends
+#define REPL_WINDOW 64                     // unacknowledged deltas in flight
+#define REPL_BATCH_INTERVAL_MS 100         // oldest pending delta waits at most this long
+// Written frames only: the transport's own ACK and reply reads (a 5-byte
+// header read per send, plus one every I2C_IDLE_POLL_MS) come on top. At
+// this rate the bus is ~12% busy at worst at 100 kHz (tools/i2c_bench,
+// 20 msg/s x 55 B: 1300 B/s)
+#define REPL_FRAMES_PER_SECOND 20
+#define REPL_BURST_FRAMES 4
+#define REPL_ACK_TIMEOUT_MS 1000           // no progress: resend from the last ACK
+#define REPL_SERVICE_PERIOD_MS 20
+
+enum ReplicationCommand : uint8_t {
+    REPL_DELTA_BATCH = 0x20,
+    REPL_SNAPSHOT_BEGIN = 0x21,
+    REPL_SNAPSHOT_ROWS = 0x22,
+    REPL_SNAPSHOT_END = 0x23,
+    REPL_ACK = 0x24
+};
+
+struct ReplicationDelta {
+    uint32_t sequence;
+    ProfileChangeType type;
+    uint16_t slot;
+    uint16_t number;
+    uint32_t timestamp;
+    char keyword[KEYWORD_MAX_LENGTH];
+};
+
+// AtomS3R side: collects deltas from storage_manager and ships them
+class ProfileReplicator {
+public:
+    ProfileReplicator();
+
+    void begin(uint32_t session_id);
+    void record(ProfileChangeType type, int slot, const VoiceProfile& profile);
+    void service(uint32_t now_ms);
+
+    uint32_t lastSequence();
+    uint32_t ackedSequence() const { return acked; }
+    bool isSnapshotting() const { return snapshot_state != SNAPSHOT_IDLE; }
+
+private:
+    enum SnapshotState : uint8_t { SNAPSHOT_IDLE, SNAPSHOT_BEGIN, SNAPSHOT_ROWS, SNAPSHOT_END };
+
+    std::mutex log_lock;        // record() runs under the table lock on either core
+    ReplicationDelta log[REPL_LOG_ENTRIES];
+    uint32_t last_sequence;     // newest delta in the log
+    bool snapshot_needed;
+
+    uint32_t session;
+    uint32_t acked;
+    uint32_t next_send;
+    uint32_t last_progress_ms;
+    uint32_t pending_since_ms;  // when the oldest unsent delta was first seen
+    uint32_t last_refill_ms;
+    int32_t tokens;             // frames; a long message may overdraw
+
+    SnapshotState snapshot_state;
+    uint32_t snapshot_sequence;
+    int snapshot_cursor;
+    uint16_t snapshot_rows;     // rows sent, so the replica can spot lost frames
+
+    void pollAck(uint32_t now_ms);
+    size_t sendBatch(uint32_t now_ms);
+    size_t sendSnapshotStep();
+    void startSnapshot();
+};
+
+// Feather side: a read-only copy for local number lookups and staff queries
+class ProfileReplica {
+public:
+    explicit ProfileReplica(size_t max_slots);
+
+    // Applies one message; true when an ACK should go back
+    bool apply(const I2CMessage& msg);
+    void acknowledge();
+
+    // Keyword text of the active profile holding the number
+    bool lookupNumber(uint16_t number, char* keyword, size_t keyword_size, uint32_t* timestamp = nullptr) const;
+    size_t findKeyword(const char* keyword, uint16_t* numbers, size_t max_numbers) const;
+
+    int activeCount() const { return active_count; }
+    uint32_t appliedSequence() const { return applied; }
+    uint32_t sessionId() const { return session; }
+
+private:
+    std::vector<uint16_t> numbers;
+    std::vector<uint32_t> timestamps;
+    std::vector<char> keywords;
+    std::vector<uint8_t> active;
+    int16_t number_slots[NUMBER_ALLOCATOR_CAPACITY];
+    KeywordIndex keyword_index;
+    int active_count;
+
+    uint32_t session;
+    uint32_t applied;
+    bool in_snapshot;
+
+    void clear();
+    void store(const ReplicationDelta& delta);
+    const uint8_t* applyRecords(const uint8_t* in, const uint8_t* end, uint8_t count, uint32_t first_sequence);
+};
+
+// AtomS3R: feed storage_manager changes to the Feather (service task on device)
+bool replication_begin();
+void replication_service(uint32_t now_ms);
+
+// Feather: hold the replica and answer the controller
+bool replica_begin();
+void replica_service();
+const ProfileReplica& replica();
+
+#endif // PROFILE_REPLICATION_H
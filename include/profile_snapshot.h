@@ -0,0 +1,46 @@
+#ifndef PROFILE_SNAPSHOT_H
+#define PROFILE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "profile_table.h"
+
+// Column snapshot of the profile table, for bulk export and import.
+//
+// Header (32 bytes, little endian):
+//   "SLPS" | version u16 | header size u16 | rows u32 | column count u16
+//   | signature size u16 | keyword size u16 | reserved u16
+//   | crc32 u32 over every column block | reserved 8 bytes
+// Column block, repeated:
+//   column id u16 | reserved u16 | length u32 | data, zero padded to 4 bytes
+//
+// Column data is the table's own little-endian layout for the first rows
+// slots, so a load is one read per column straight into the table.
+// Readers skip column ids they don't know.
+
+#ifdef ESP32
+#define PROFILE_EXPORT_PATH "/littlefs/profiles.slps"
+#else
+#define PROFILE_EXPORT_PATH "profiles.slps"
+#endif
+
+#define PROFILE_SNAPSHOT_VERSION 1
+#define PROFILE_SNAPSHOT_HEADER_SIZE 32
+#define PROFILE_SNAPSHOT_BLOCK_HEADER_SIZE 8
+
+struct ProfileSnapshotInfo {
+    uint16_t version;
+    uint32_t rows;
+    uint16_t columns;
+    uint32_t crc;
+};
+
+bool profile_snapshot_write(const char* path, ProfileTable& table, size_t rows);
+
+// Checks header, layout and checksum without touching a table
+bool profile_snapshot_verify(const char* path, size_t capacity, ProfileSnapshotInfo* info);
+
+// Loads rows into the table; slots past them are cleared
+bool profile_snapshot_read(const char* path, ProfileTable& table, size_t* rows);
+
+#endif // PROFILE_SNAPSHOT_H
@@ -0,0 +1,90 @@
+#ifndef PROFILE_TABLE_H
+#define PROFILE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "storage_manager.h"
+#include "voice_matcher.h"
+
+#define PROFILE_SIGNATURE_ALIGN 32             // one signature row per 32-byte line
+#define PROFILE_PSRAM_THRESHOLD 16384          // cold columns larger than this go to PSRAM
+
+// Column ids, in table order; also the block ids of the SLPS snapshot
+enum ProfileColumn : uint16_t {
+    COLUMN_KEYWORD_HASHES = 1,
+    COLUMN_VOICE_HASHES,
+    COLUMN_NUMBERS,
+    COLUMN_ACTIVE_BITS,
+    COLUMN_SIGNATURES,
+    COLUMN_INVERSE_NORMS,
+    COLUMN_PITCHES,
+    COLUMN_KEYWORDS,
+    COLUMN_TIMESTAMPS
+};
+#define PROFILE_COLUMN_COUNT 9
+
+// Columnar profile store. Lookups and scoring only touch the hot columns
+// and the signature matrix; keyword text and timestamps are cold and are
+// read when a profile is materialized or persisted.
+//
+//   hot:    keyword_hashes, voice_hashes, numbers, active bitmap
+//   matrix: signatures (capacity x VOICE_SIGNATURE_SIZE floats, row aligned),
+//           pitches and inverse signature norms
+//   cold:   keywords, timestamps
+class ProfileTable {
+public:
+    explicit ProfileTable(size_t capacity);
+    ~ProfileTable();
+
+    ProfileTable(const ProfileTable&) = delete;
+    ProfileTable& operator=(const ProfileTable&) = delete;
+
+    bool isAllocated() const { return allocated; }
+    size_t capacity() const { return slots; }
+
+    // Row access by slot
+    void store(size_t slot, const VoiceProfile& profile);
+    void load(size_t slot, VoiceProfile* profile) const;
+    void clear(size_t slot);
+
+    bool isActive(size_t slot) const { return (active_bits[slot >> 5] >> (slot & 31)) & 1; }
+    void setActive(size_t slot, bool active);
+
+    uint32_t keywordHash(size_t slot) const { return keyword_hashes[slot]; }
+    uint32_t voiceHash(size_t slot) const { return voice_hashes[slot]; }
+    uint16_t number(size_t slot) const { return numbers[slot]; }
+    const char* keyword(size_t slot) const { return keywords + slot * KEYWORD_TEXT_SIZE; }
+    uint32_t timestamp(size_t slot) const { return timestamps[slot]; }
+    const float* signature(size_t slot) const { return signatures + slot * VOICE_SIGNATURE_SIZE; }
+
+    // View for voice_match_rows()
+    SignatureMatrix matrix() const { return {signatures, inverse_norms, pitches}; }
+
+    // Raw column storage for bulk I/O. A prefix of rows occupies the first
+    // columnBytes(column, rows) bytes; nullptr for an unknown column
+    void* columnData(ProfileColumn column);
+    size_t columnBytes(ProfileColumn column, size_t rows) const;
+
+private:
+    static const size_t KEYWORD_TEXT_SIZE = sizeof(VoiceProfile::keyword);
+
+    size_t slots;
+    bool allocated;
+
+    uint32_t* keyword_hashes;
+    uint32_t* voice_hashes;
+    uint16_t* numbers;
+    uint32_t* active_bits;
+
+    float* signatures;
+    float* inverse_norms;
+    float* pitches;
+
+    char* keywords;
+    uint32_t* timestamps;
+
+    static void* allocate(size_t bytes, size_t alignment, bool allow_psram);
+    static void release(void* column);
+};
+
+#endif // PROFILE_TABLE_H
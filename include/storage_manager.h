@@ -2,21 +2,79 @@
 #define STORAGE_MANAGER_H
 
 #include <cstdint>
+#include <functional>
+#include "voice_features.h"
+#include "number_allocator.h"
+
+#define MAX_PROFILES 1000
+#define PROFILE_TTL_SECONDS (12 * 60 * 60)   // active profiles expire after one shift
+#define PROFILE_EPOCH_VALID 1600000000u       // wall-clock seconds below this: clock not set
+#define PROFILE_NTP_SERVER "pool.ntp.org"
+
+struct VoiceFeatures;
 
 struct VoiceProfile {
     char keyword[32];
     uint32_t voice_hash;
     float pitch_average;
-    float tone_signature[8];
+    float tone_signature[VOICE_SIGNATURE_SIZE];
     uint16_t assignment_number;
     uint32_t timestamp;
     bool active;
 };
 
-// Storage functions
+// Persistence: storage_begin() replays the flash journal into the table
+// and, on the device, starts the task that runs storage_service()
+bool storage_begin();
+void storage_service(uint32_t now_ms);
 void store_voice_profile();
-bool add_voice_profile(const VoiceProfile& profile);
-VoiceProfile* find_voice_profile(const char* keyword, uint32_t voice_hash);
+
+// Storage functions. Profiles live in a columnar table and are addressed
+// by slot; load_voice_profile() materializes a full row when needed.
+// add_voice_profile() draws a number from the pool (preferring zone under
+// NUMBER_POLICY_AFFINITY) when assignment_number is 0, otherwise claims
+// the given one; it returns the stored number, or 0 on failure
+uint16_t add_voice_profile(const VoiceProfile& profile, int zone = -1);
+int find_voice_profile(const char* keyword, uint32_t voice_hash);
+bool load_voice_profile(int slot, VoiceProfile* profile);
+uint16_t profile_assignment_number(int slot);
 bool deactivate_profile(const char* keyword, uint32_t voice_hash);
+// Retires a matched slot at pickup; its number goes straight back to the pool
+bool deactivate_profile_slot(int slot);
+int active_profile_count();
+int assignment_numbers_available();
+void set_assignment_policy(NumberPolicy policy);
+
+// Expiry: a profile is retired profile TTL after its timestamp, in
+// wall-clock (epoch) seconds, so rows restored after a power cycle are aged
+// by the time the device was off. A timestamp of 0 means the clock was not
+// set yet; such a row gets its TTL from boot. Rows restored before NTP has
+// set the clock are re-aged once it is. expire_all_profiles() retires
+// everything at end of shift. Both run in storage_service(), never on the
+// caller's path
+uint32_t profile_timestamp_now();   // epoch seconds, or 0 while the clock is unset
+void set_profile_ttl(uint32_t seconds);
+void expire_all_profiles();
+
+// Bulk transfer through an SLPS column snapshot (profile_snapshot.h).
+// Import replaces the whole table and returns the active count, or -1
+bool export_profiles(const char* path);
+int import_profiles(const char* path);
+
+// Change feed for replication, called under the table lock after each
+// stored or retired profile. RESET means the whole table was replaced
+enum ProfileChangeType : uint8_t {
+    PROFILE_CHANGE_ADD = 1,
+    PROFILE_CHANGE_DEACTIVATE = 2,
+    PROFILE_CHANGE_RESET = 3
+};
+typedef std::function<void(ProfileChangeType type, int slot, const VoiceProfile& profile)> ProfileChangeListener;
+void set_profile_change_listener(const ProfileChangeListener& listener);
+
+// Slots below this may hold profiles; for full-table walks with load_voice_profile()
+int profile_slot_count();
+
+// Slot of the best-scoring active profile for the keyword, or -1 below the match threshold
+int match_voice_profile(const char* keyword, const VoiceFeatures& features, float* confidence = nullptr);
 
 #endif // STORAGE_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef VIRTUAL_I2C_BUS_H
+#define VIRTUAL_I2C_BUS_H
+
+#ifndef ESP32
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Simulated bus between the AtomS3R controller and the Feather peripheral,
+// for host builds. Transfers run synchronously through the peripheral's
+// handlers, but each one advances a simulated clock by what it would cost
+// on the wire, and the link can be made to misbehave.
+//
+// Timing per transaction: start + address byte + data bytes at 9 clocks
+// each (8 bits and ACK) + stop. Before answering a read the peripheral
+// may stretch the clock; a stretch past the controller's timeout fails
+// the transfer, as Wire's timeout does.
+
+#define VIRTUAL_I2C_START_STOP_CLOCKS 2
+#define VIRTUAL_I2C_CLOCKS_PER_BYTE 9
+
+struct VirtualI2CConfig {
+    uint32_t clock_hz;
+    uint32_t stretch_us;            // typical stretch before a read reply
+    uint32_t stretch_jitter_us;     // uniform extra on top of it
+    uint32_t timeout_us;            // controller gives up on a longer stretch
+    double nack_rate;               // chance the address byte is not acknowledged
+    double bit_error_rate;          // chance each data bit arrives flipped
+    uint32_t seed;
+};
+
+VirtualI2CConfig virtual_i2c_default_config();
+
+struct VirtualI2CStats {
+    uint64_t writes;
+    uint64_t reads;
+    uint64_t nacks;
+    uint64_t timeouts;
+    uint64_t bytes;                 // data bytes clocked, address bytes excluded
+    uint64_t bits_flipped;
+    uint64_t busy_us;               // time the bus was driven
+};
+
+// The peripheral's side, as Wire::onReceive/onRequest see it
+struct VirtualI2CPeripheral {
+    void (*on_receive)(const uint8_t* data, size_t size);
+    size_t (*on_request)(uint8_t* data);   // fills up to I2C_FRAME_MAX bytes
+};
+
+class VirtualI2CBus {
+public:
+    explicit VirtualI2CBus(const VirtualI2CConfig& config);
+
+    void attach(const VirtualI2CPeripheral& peripheral);
+
+    // Controller transfers; false / 0 on NACK or timeout
+    bool write(const uint8_t* data, size_t size);
+    size_t read(uint8_t* data, size_t size);
+
+    // Simulated time; callers may skip ahead while the bus idles
+    uint64_t nowUs() const { return now_us; }
+    void advanceTo(uint64_t us);
+
+    const VirtualI2CStats& stats() const { return counters; }
+    const VirtualI2CConfig& config() const { return settings; }
+
+private:
+    VirtualI2CConfig settings;
+    VirtualI2CPeripheral target;
+    VirtualI2CStats counters;
+    uint64_t now_us;
+    std::mt19937 random;
+
+    bool chance(double rate);
+    void clock(size_t bytes);
+    void corrupt(uint8_t* data, size_t size);
+};
+
+// Routes the host build's controller transfers through bus instead of
+// straight into the peripheral handlers; nullptr restores the loopback
+void i2c_attach_virtual_bus(VirtualI2CBus* bus);
+
+#endif // ESP32
+
+#endif // VIRTUAL_I2C_BUS_H
@@ -0,0 +1,71 @@
+#ifndef VOICE_ACTIVITY_H
+#define VOICE_ACTIVITY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define VAD_FRAME_SAMPLES 320 // 20 ms at 16 kHz
+
+struct VadConfig {
+    uint16_t frame_samples;     // samples per analysis frame
+    uint16_t energy_ratio_q4;   // speech if energy > noise floor * ratio / 16
+    uint32_t min_energy;        // absolute mean-square floor for speech
+    uint16_t zcr_max;           // crossings per frame above which quiet frames count as hiss
+    uint16_t start_frames;      // consecutive speech frames needed for onset
+    uint16_t hangover_frames;   // trailing non-speech frames before end-of-speech
+    uint16_t pre_roll_frames;   // frames kept before onset when trimming
+    uint16_t tail_frames;       // frames kept after the last speech frame
+    uint8_t noise_adapt_shift;  // noise floor tracks at 1 / 2^shift per frame
+};
+
+enum VadState {
+    VAD_WAITING,   // no speech yet
+    VAD_SPEECH,    // inside an utterance
+    VAD_HANGOVER,  // speech paused, counting down the hangover
+    VAD_ENDED      // end-of-speech declared
+};
+
+VadConfig vad_default_config();
+
+// Streaming endpoint detector fed one frame at a time from the capture path
+class VoiceActivityDetector {
+public:
+    explicit VoiceActivityDetector(const VadConfig& config = vad_default_config());
+
+    void reset();
+    void setConfig(const VadConfig& new_config);
+    const VadConfig& getConfig() const { return config; }
+
+    // Classifies one frame and advances the state machine
+    VadState processFrame(const int16_t* frame, size_t samples);
+
+    VadState getState() const { return state; }
+    bool speechDetected() const { return state != VAD_WAITING; }
+    bool speechEnded() const { return state == VAD_ENDED; }
+
+    // Trim bounds in samples since reset(), including pre-roll and tail
+    size_t speechStartSample() const;
+    size_t speechEndSample() const;
+
+    uint32_t noiseFloor() const { return noise_floor; }
+    uint32_t lastEnergy() const { return last_energy; }
+    uint16_t lastZeroCrossings() const { return last_zcr; }
+
+private:
+    VadConfig config;
+    VadState state;
+    uint32_t noise_floor;
+    bool noise_initialized;
+    uint32_t last_energy;
+    uint16_t last_zcr;
+    uint16_t speech_run;
+    uint16_t silence_run;
+    size_t total_samples;
+    size_t onset_sample;
+    size_t last_speech_end;
+
+    bool isSpeechFrame(uint32_t energy, uint16_t zcr) const;
+    void adaptNoiseFloor(uint32_t energy);
+};
+
+#endif // VOICE_ACTIVITY_H
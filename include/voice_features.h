@@ -0,0 +1,47 @@
+#ifndef VOICE_FEATURES_H
+#define VOICE_FEATURES_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define VOICE_SIGNATURE_SIZE 8     // cepstral coefficients c1..c8 stored per profile
+#define FEATURE_FRAME_SAMPLES 400  // 25 ms analysis window at 16 kHz
+#define FEATURE_HOP_SAMPLES 160    // 10 ms between frames
+#define FEATURE_FFT_SIZE 512
+#define FEATURE_MEL_BANDS 20
+
+// Incremental MFCC front end: pre-emphasis, Hann window, Q15 real FFT,
+// mel filterbank, log and DCT. Frames are analyzed as samples arrive, so
+// the utterance signature is ready as soon as the last frame is pushed.
+class VoiceFeatureExtractor {
+public:
+    VoiceFeatureExtractor();
+
+    void reset();
+    void pushSamples(const int16_t* samples, size_t count);
+
+    size_t frameCount() const { return frames; }
+
+    // Mean cepstrum over all analyzed frames; false if nothing was analyzed
+    bool getSignature(float tone_signature[VOICE_SIGNATURE_SIZE]) const;
+
+    // MFCCs of the most recent frame, c0 first
+    const float* lastCepstrum() const { return cepstrum; }
+
+private:
+    int16_t window[FEATURE_FRAME_SAMPLES]; // pre-emphasized samples, oldest first
+    size_t fill;
+    int16_t previous_sample;
+    size_t frames;
+    float cepstrum_sum[VOICE_SIGNATURE_SIZE];
+    float cepstrum[VOICE_SIGNATURE_SIZE + 1];
+
+    // FFT working set, kept here so analysis never touches the task stack
+    int16_t fft_re[FEATURE_FFT_SIZE / 2];
+    int16_t fft_im[FEATURE_FFT_SIZE / 2];
+    float mel_energy[FEATURE_MEL_BANDS];
+
+    void analyzeFrame();
+};
+
+#endif // VOICE_FEATURES_H
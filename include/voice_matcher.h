@@ -0,0 +1,48 @@
+#ifndef VOICE_MATCHER_H
+#define VOICE_MATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "storage_manager.h"
+#include "voice_features.h"
+
+#define MATCH_THRESHOLD 0.85f  // Default: 85%, adjustable 0.70 - 0.95
+#define MATCH_THRESHOLD_MIN 0.70f
+#define MATCH_THRESHOLD_MAX 0.95f
+
+// Biometrics captured for one utterance
+struct VoiceFeatures {
+    float pitch_average;
+    float tone_signature[VOICE_SIGNATURE_SIZE];
+};
+
+struct VoiceMatchResult {
+    int index;         // best candidate, -1 if none reached the threshold
+    float confidence;  // score of the best candidate, even when rejected
+};
+
+// Accept threshold shared by every matcher call
+void set_match_threshold(float threshold);
+float get_match_threshold();
+
+// Similarity in [0, 1]: cosine of the cepstral signatures blended with pitch closeness
+float voice_match_score(const VoiceFeatures& probe, const float* tone_signature, float pitch_average);
+
+// Scores every candidate in one pass; scores may be null
+VoiceMatchResult voice_match_best(const VoiceFeatures& probe, const VoiceProfile* const* candidates,
+                                  size_t count, float* scores = nullptr);
+
+// Columnar candidates: row r is signatures[r * VOICE_SIGNATURE_SIZE ...],
+// with its inverse L2 norm and pitch alongside
+struct SignatureMatrix {
+    const float* signatures;
+    const float* inverse_norms;
+    const float* pitches;
+};
+
+// Scores the listed rows (all rows 0..count-1 when rows is null);
+// result.index is a position in rows
+VoiceMatchResult voice_match_rows(const VoiceFeatures& probe, const SignatureMatrix& matrix,
+                                  const int16_t* rows, size_t count, float* scores = nullptr);
+
+#endif // VOICE_MATCHER_H
@@ -4,16 +4,29 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <functional>
+#include "audio_codec.h"
+
+struct VoiceFeatures;
 
 // Function declarations
 void capture_voice();
 void process_keyword(const char* keyword);
-bool register_user(const char* keyword, uint32_t voice_hash);
-int match_user(const char* keyword, uint32_t voice_hash);
+bool register_user(const char* keyword, const VoiceFeatures& features);
+int match_user(const char* keyword, const VoiceFeatures& features, float* confidence = nullptr);
 
 // ElevenLabs API functions
-std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data);
+// Recordings are re-encoded to upload_format before the request
+#define STT_UPLOAD_FORMAT AUDIO_FORMAT_ADPCM
+std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data,
+                                      AudioFormat upload_format = STT_UPLOAD_FORMAT);
 std::vector<uint8_t> elevenlabs_text_to_speech(const std::string& text);
 std::string get_elevenlabs_api_key();
 
+// TTS audio is 16 kHz mono 16-bit PCM, delivered chunk by chunk as it
+// downloads; the sink returns false to cancel the request
+#define TTS_OUTPUT_FORMAT "pcm_16000"
+typedef std::function<bool(const uint8_t* data, size_t length)> TtsAudioSink;
+bool elevenlabs_text_to_speech_stream(const std::string& text, const TtsAudioSink& sink);
+
 #endif // VOICE_PROCESSOR_H
\ No newline at end of file
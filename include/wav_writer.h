@@ -0,0 +1,57 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#define WAV_HEADER_SIZE 44
+#define WAV_STREAMING_SIZE 0xFFFFFFFFu // size field value for streams of unknown length
+
+// Header helpers; header must point at WAV_HEADER_SIZE writable bytes
+void wav_write_header(uint8_t* header, uint32_t sample_rate, uint16_t channels,
+                      uint16_t bits_per_sample, uint32_t data_bytes);
+void wav_patch_sizes(uint8_t* header, uint32_t data_bytes);
+
+// Locates the PCM payload of a RIFF/WAVE buffer, walking any extra chunks
+bool wav_find_data(const uint8_t* wav, size_t length, size_t* data_offset, size_t* data_bytes);
+
+// In-place framing: PCM is captured straight into the buffer behind a
+// reserved header, which is filled in once the final length is known
+std::vector<uint8_t> wav_allocate(size_t max_samples);
+inline int16_t* wav_samples(std::vector<uint8_t>& wav) {
+    return reinterpret_cast<int16_t*>(wav.data() + WAV_HEADER_SIZE);
+}
+void wav_finalize(std::vector<uint8_t>& wav, size_t samples, uint32_t sample_rate);
+
+typedef std::function<bool(const uint8_t* data, size_t length)> WavSink;
+
+// Streaming mode: emits the header first, then PCM chunks as they arrive
+class WavStreamWriter {
+public:
+    WavStreamWriter(WavSink sink, uint32_t sample_rate, uint16_t channels = 1, uint16_t bits_per_sample = 16);
+
+    // Pass the exact payload size when known, otherwise the header carries WAV_STREAMING_SIZE
+    bool begin(uint32_t expected_data_bytes = WAV_STREAMING_SIZE);
+    bool writeSamples(const int16_t* samples, size_t count);
+    bool write(const uint8_t* data, size_t length);
+
+    // Returns the payload size; seekable sinks can rewrite the header from finalHeader()
+    uint32_t finish();
+    void finalHeader(uint8_t* header) const;
+
+    uint32_t bytesWritten() const { return data_bytes; }
+    bool failed() const { return error; }
+
+private:
+    WavSink sink;
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    uint32_t data_bytes;
+    bool started;
+    bool error;
+};
+
+#endif // WAV_WRITER_H
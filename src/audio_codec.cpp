@@ -0,0 +1,249 @@
+// IMA-ADPCM and 2:1 decimation for compact uploads and archives
+#include "audio_codec.h"
+#include "wav_writer.h"
+#include <cstring>
+
+static const int16_t step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Half-band taps at odd offsets 1, 3, ..., 13 from the center (Q15);
+// the even offsets are all zero apart from the center tap itself
+#define HALFBAND_CENTER 16386
+#define HALFBAND_TAPS 7
+static const int16_t halfband_taps[HALFBAND_TAPS] = {10244, -2953, 1314, -587, 233, -73, 13};
+
+static inline void put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static inline void put_le32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static inline uint16_t get_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int16_t clamp16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+// Applies one nibble to the state exactly as a decoder would
+static inline int16_t adpcm_step(AdpcmState& state, uint8_t nibble) {
+    int32_t step = step_table[state.step_index];
+    int32_t diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+
+    state.predictor = clamp16(nibble & 8 ? state.predictor - diff : state.predictor + diff);
+
+    int index = state.step_index + index_table[nibble];
+    state.step_index = index < 0 ? 0 : (index > 88 ? 88 : index);
+    return state.predictor;
+}
+
+static inline uint8_t adpcm_encode_sample(AdpcmState& state, int16_t sample) {
+    int32_t step = step_table[state.step_index];
+    int32_t diff = (int32_t)sample - state.predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+
+    // Successive approximation of diff / step in three bits
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 1;
+    }
+
+    adpcm_step(state, nibble);
+    return nibble;
+}
+
+void adpcm_encode_block(const int16_t* pcm, size_t samples, AdpcmState& state, uint8_t* block) {
+    if (samples > ADPCM_SAMPLES_PER_BLOCK) {
+        samples = ADPCM_SAMPLES_PER_BLOCK;
+    }
+
+    // The first sample travels verbatim, so errors never cross a block
+    state.predictor = samples > 0 ? pcm[0] : 0;
+    put_le16(block, (uint16_t)state.predictor);
+    block[2] = state.step_index;
+    block[3] = 0;
+
+    uint8_t* out = block + 4;
+    memset(out, 0, ADPCM_BLOCK_ALIGN - 4);
+    for (size_t i = 1; i < samples; i++) {
+        uint8_t nibble = adpcm_encode_sample(state, pcm[i]);
+        size_t position = i - 1;
+        out[position >> 1] |= (position & 1) ? (nibble << 4) : nibble;
+    }
+}
+
+size_t adpcm_decode_block(const uint8_t* block, size_t block_bytes, int16_t* pcm) {
+    if (block_bytes < 4) {
+        return 0;
+    }
+
+    AdpcmState state;
+    state.predictor = (int16_t)get_le16(block);
+    state.step_index = block[2] > 88 ? 88 : block[2];
+    pcm[0] = state.predictor;
+
+    size_t samples = 1;
+    for (size_t i = 4; i < block_bytes; i++) {
+        pcm[samples++] = adpcm_step(state, block[i] & 0x0F);
+        pcm[samples++] = adpcm_step(state, block[i] >> 4);
+    }
+    return samples;
+}
+
+size_t audio_decimate_2x(const int16_t* in, size_t samples, int16_t* out) {
+    const size_t out_samples = samples / 2;
+    const int32_t reach = 2 * HALFBAND_TAPS - 1;
+
+    for (size_t m = 0; m < out_samples; m++) {
+        const int32_t center = (int32_t)(2 * m);
+        int32_t acc = (int32_t)HALFBAND_CENTER * in[center];
+
+        if (center >= reach && center + reach < (int32_t)samples) {
+            // Interior: symmetric taps folded so each pair costs one multiply
+            for (int k = 0; k < HALFBAND_TAPS; k++) {
+                int32_t offset = 2 * k + 1;
+                acc += (int32_t)halfband_taps[k] * ((int32_t)in[center - offset] + in[center + offset]);
+            }
+        } else {
+            // Edges: samples outside the buffer count as silence
+            for (int k = 0; k < HALFBAND_TAPS; k++) {
+                int32_t offset = 2 * k + 1;
+                int32_t pair = 0;
+                if (center - offset >= 0) pair += in[center - offset];
+                if (center + offset < (int32_t)samples) pair += in[center + offset];
+                acc += (int32_t)halfband_taps[k] * pair;
+            }
+        }
+        out[m] = clamp16((acc + (1 << 14)) >> 15);
+    }
+    return out_samples;
+}
+
+static std::vector<uint8_t> encode_adpcm_wav(const int16_t* pcm, size_t samples, uint32_t sample_rate) {
+    size_t blocks = (samples + ADPCM_SAMPLES_PER_BLOCK - 1) / ADPCM_SAMPLES_PER_BLOCK;
+    uint32_t data_bytes = (uint32_t)(blocks * ADPCM_BLOCK_ALIGN);
+    std::vector<uint8_t> wav(ADPCM_WAV_HEADER_SIZE + data_bytes);
+    uint8_t* header = wav.data();
+
+    memcpy(header, "RIFF", 4);
+    put_le32(header + 4, ADPCM_WAV_HEADER_SIZE - 8 + data_bytes);
+    memcpy(header + 8, "WAVE", 4);
+
+    memcpy(header + 12, "fmt ", 4);
+    put_le32(header + 16, 20);
+    put_le16(header + 20, 0x0011);                   // IMA ADPCM
+    put_le16(header + 22, 1);
+    put_le32(header + 24, sample_rate);
+    put_le32(header + 28, sample_rate * ADPCM_BLOCK_ALIGN / ADPCM_SAMPLES_PER_BLOCK);
+    put_le16(header + 32, ADPCM_BLOCK_ALIGN);
+    put_le16(header + 34, 4);
+    put_le16(header + 36, 2);                        // extra format bytes
+    put_le16(header + 38, ADPCM_SAMPLES_PER_BLOCK);
+
+    // Sample count, since the last block is padded
+    memcpy(header + 40, "fact", 4);
+    put_le32(header + 44, 4);
+    put_le32(header + 48, (uint32_t)samples);
+
+    memcpy(header + 52, "data", 4);
+    put_le32(header + 56, data_bytes);
+
+    AdpcmState state = {0, 0};
+    uint8_t* block = header + ADPCM_WAV_HEADER_SIZE;
+    for (size_t offset = 0; offset < samples; offset += ADPCM_SAMPLES_PER_BLOCK) {
+        size_t count = samples - offset;
+        adpcm_encode_block(pcm + offset, count, state, block);
+        block += ADPCM_BLOCK_ALIGN;
+    }
+    return wav;
+}
+
+std::vector<uint8_t> audio_encode_wav(const int16_t* pcm, size_t samples, uint32_t sample_rate, AudioFormat format) {
+    std::vector<int16_t> decimated;
+    if (format == AUDIO_FORMAT_PCM16_8K || format == AUDIO_FORMAT_ADPCM_8K) {
+        decimated.resize(samples / 2);
+        samples = audio_decimate_2x(pcm, samples, decimated.data());
+        pcm = decimated.data();
+        sample_rate /= 2;
+    }
+
+    if (format == AUDIO_FORMAT_ADPCM || format == AUDIO_FORMAT_ADPCM_8K) {
+        return encode_adpcm_wav(pcm, samples, sample_rate);
+    }
+
+    std::vector<uint8_t> wav = wav_allocate(samples);
+    memcpy(wav_samples(wav), pcm, samples * sizeof(int16_t));
+    wav_finalize(wav, samples, sample_rate);
+    return wav;
+}
+
+std::vector<uint8_t> audio_transcode_wav(const std::vector<uint8_t>& wav, AudioFormat format) {
+    size_t data_offset = 0;
+    size_t data_bytes = 0;
+    if (format == AUDIO_FORMAT_PCM16 || wav.size() < WAV_HEADER_SIZE ||
+        !wav_find_data(wav.data(), wav.size(), &data_offset, &data_bytes)) {
+        return wav;
+    }
+
+    // Only mono 16-bit PCM input is re-encoded
+    const uint8_t* fmt = wav.data() + 20;
+    if (memcmp(wav.data() + 12, "fmt ", 4) != 0 || get_le16(fmt) != 1 || get_le16(fmt + 2) != 1 ||
+        get_le16(fmt + 14) != 16) {
+        return wav;
+    }
+
+    uint32_t sample_rate = get_le32(fmt + 4);
+    const int16_t* pcm = reinterpret_cast<const int16_t*>(wav.data() + data_offset);
+    return audio_encode_wav(pcm, data_bytes / sizeof(int16_t), sample_rate, format);
+}
+
+const char* audio_format_name(AudioFormat format) {
+    switch (format) {
+        case AUDIO_FORMAT_PCM16: return "pcm16";
+        case AUDIO_FORMAT_PCM16_8K: return "pcm16_8k";
+        case AUDIO_FORMAT_ADPCM: return "adpcm";
+        case AUDIO_FORMAT_ADPCM_8K: return "adpcm_8k";
+    }
+    return "unknown";
+}
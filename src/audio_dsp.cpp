@@ -0,0 +1,98 @@
+// Fixed-point audio kernels for the capture hot path
+//
+// Each kernel is a single branch-free loop over int16 samples with 32-bit
+// intermediates, so GCC vectorizes it on host (-O2 -ftree-vectorize) and it
+// stays a tight MAC loop on Xtensa. There is only one definition of each
+// kernel, which keeps host and device results bit-identical.
+#include "audio_dsp.h"
+#include <cmath>
+
+static inline int32_t saturate16(int32_t value) {
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+DspGain dsp_gain_from_float(float gain) {
+    DspGain result = {0, 0};
+    if (!(gain > 0.0f)) {
+        return result;
+    }
+
+    // Normalize into [0.5, 1) so the mantissa keeps full Q15 precision
+    uint8_t shift = 0;
+    while (gain >= 1.0f && shift < 15) {
+        gain *= 0.5f;
+        shift++;
+    }
+
+    int32_t q15 = (int32_t)lrintf(gain * 32768.0f);
+    result.q15 = (int16_t)(q15 > 32767 ? 32767 : q15);
+    result.shift = shift;
+    return result;
+}
+
+void dsp_apply_gain(int16_t* __restrict samples, size_t count, DspGain gain) {
+    const int32_t q15 = gain.q15;
+    const int rshift = 15 - (gain.shift > 15 ? 15 : gain.shift);
+    const int32_t round = rshift > 0 ? (1 << (rshift - 1)) : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t scaled = ((int32_t)samples[i] * q15 + round) >> rshift;
+        samples[i] = (int16_t)saturate16(scaled);
+    }
+}
+
+int64_t dsp_sum_squares(const int16_t* __restrict samples, size_t count) {
+    // Each square fits in 31 bits; only the running total needs 64
+    int64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        total += (uint32_t)(s * s);
+    }
+    return total;
+}
+
+float dsp_rms(const int16_t* samples, size_t count) {
+    if (count == 0) return 0.0f;
+    double mean_square = (double)dsp_sum_squares(samples, count) / (double)count;
+    return (float)sqrt(mean_square);
+}
+
+int32_t dsp_peak(const int16_t* __restrict samples, size_t count) {
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        int32_t magnitude = s < 0 ? -s : s;
+        peak = magnitude > peak ? magnitude : peak;
+    }
+    return peak;
+}
+
+int64_t dsp_sum(const int16_t* __restrict samples, size_t count) {
+    // 1024 full-scale samples still fit a 32-bit partial sum
+    int64_t total = 0;
+    size_t i = 0;
+    for (; i + 1024 <= count; i += 1024) {
+        int32_t partial = 0;
+        for (size_t j = 0; j < 1024; j++) {
+            partial += samples[i + j];
+        }
+        total += partial;
+    }
+    for (; i < count; i++) {
+        total += samples[i];
+    }
+    return total;
+}
+
+int16_t dsp_remove_dc(int16_t* __restrict samples, size_t count) {
+    if (count == 0) return 0;
+
+    int64_t sum = dsp_sum(samples, count);
+    int64_t half = (int64_t)(count / 2);
+    int32_t offset = (int32_t)((sum >= 0 ? sum + half : sum - half) / (int64_t)count);
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)saturate16((int32_t)samples[i] - offset);
+    }
+    return (int16_t)offset;
+}
@@ -7,8 +7,27 @@
 #define AUDIO_MANAGER_H
 
 #include <driver/i2s.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+
+#include "audio_dsp.h"
+#include "audio_ring_buffer.h"
+#include "pitch_tracker.h"
+#include "voice_activity.h"
+#include "voice_features.h"
+#include "wav_writer.h"
+
+// Sees every captured frame, after gain, on the processing task. The
+// pointer is only valid during the call; the frame goes back to the pool
+// right after, so copy what must outlive it and return quickly.
+typedef std::function<void(const int16_t* frame, size_t samples)> CaptureFrameObserver;
 
 // Audio Configuration
 #define SAMPLE_RATE 16000
@@ -17,6 +36,30 @@
 #define AUDIO_BUFFER_SIZE 2048
 #define MAX_RECORDING_DURATION 5 // seconds
 
+// Capture Engine Configuration
+#define CAPTURE_CHUNK_SAMPLES 512      // samples per i2s_read (32 ms)
+#define CAPTURE_POOL_FRAMES 16         // frames in flight between the two tasks (~0.5 s)
+#define CAPTURE_READ_TIMEOUT_MS 50
+#define CAPTURE_TASK_STACK 4096
+#define CAPTURE_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define CAPTURE_TASK_CORE 0
+#define CAPTURE_GAIN 4.0f              // mic amplification applied in the reader task
+#define VAD_NO_SPEECH_TIMEOUT_MS 4000  // give up if nobody starts talking
+
+// Processing runs on the other core: VAD, MFCC and pitch per frame
+#define PROCESSING_TASK_STACK 8192
+#define PROCESSING_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#define PROCESSING_TASK_CORE 1
+
+// Playback Pipeline Configuration
+#define PLAYBACK_STREAM_BYTES 16384    // network -> decoder byte queue (~0.5 s of PCM)
+#define PLAYBACK_BLOCK_SAMPLES 512     // mono samples per PCM block (32 ms)
+#define PLAYBACK_BLOCKS 2              // double-buffered between decoder and I2S writer
+#define PLAYBACK_WRITE_SAMPLES 256     // stereo frames per i2s_write
+#define PLAYBACK_TASK_STACK 4096
+#define PLAYBACK_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#define PLAYBACK_TASK_CORE 0
+
 // I2S Pin Configuration (AtomS3R)
 #define I2S_MIC_WS_PIN 5
 #define I2S_MIC_SD_PIN 6
@@ -35,6 +78,73 @@ private:
     size_t buffer_size;
     bool recording;
     
+    // Capture engine: frames live in a fixed pool and only their indices move
+    // between tasks. The capture task owns a frame from the moment it takes
+    // it off free_frames until it pushes it to filled_frames; the processing
+    // task owns it from there until it hands it back.
+    int16_t* capture_pool;
+    uint16_t frame_lengths[CAPTURE_POOL_FRAMES];
+    SpscRingBuffer<uint8_t> free_frames;     // processing -> capture
+    SpscRingBuffer<uint8_t> filled_frames;   // capture -> processing
+    TaskHandle_t capture_task;
+    SemaphoreHandle_t frames_ready;
+    std::atomic<bool> capture_running;
+    std::atomic<bool> capture_task_active;
+    std::atomic<uint32_t> dropped_samples;
+    DspGain capture_gain;
+    
+    VoiceActivityDetector vad;
+    VoiceFeatureExtractor features;
+    PitchTracker pitch;
+    CaptureFrameObserver frame_observer;
+    
+    // Utterance session; everything below belongs to the processing task
+    // between beginUtterance() and utterance_ready
+    SemaphoreHandle_t utterance_done;
+    std::atomic<bool> processing_task_active;
+    std::atomic<bool> utterance_ready;
+    std::vector<uint8_t> utterance_wav;
+    size_t utterance_max_samples;
+    size_t utterance_captured;
+    size_t utterance_analyzed;
+    uint32_t utterance_start_time;
+    uint32_t utterance_max_ms;
+    uint32_t utterance_no_speech_ms;
+    bool utterance_use_vad;
+    
+    static void captureTaskEntry(void* arg);
+    void runCapture();
+    static void processingTaskEntry(void* arg);
+    void runProcessing();
+    void consumeFrame(const int16_t* frame, size_t samples);
+    bool utteranceComplete();
+    void finalizeUtterance();
+    
+    // Playback pipeline: writer -> playback_stream -> decoder task ->
+    // PCM blocks (ping-pong through two queues) -> output task -> I2S_NUM_1
+    struct PlaybackBlock {
+        uint8_t index;
+        uint16_t samples;   // 0 marks the end of the stream
+    };
+    SpscRingBuffer<uint8_t> playback_stream;
+    int16_t playback_blocks[PLAYBACK_BLOCKS][PLAYBACK_BLOCK_SAMPLES];
+    int16_t playback_frames[PLAYBACK_WRITE_SAMPLES * 2];
+    QueueHandle_t free_blocks;
+    QueueHandle_t ready_blocks;
+    SemaphoreHandle_t stream_data;
+    std::atomic<bool> stream_open;
+    std::atomic<bool> stream_input_done;
+    std::atomic<bool> stream_abort;
+    std::atomic<int> playback_tasks_active;
+    uint32_t stream_start_time;
+    uint32_t stream_first_audio_ms;
+    
+    static void decoderTaskEntry(void* arg);
+    static void outputTaskEntry(void* arg);
+    void runDecoder();
+    void runOutput();
+    void waitForPlaybackTasks();
+    
 public:
     AudioManager();
     ~AudioManager();
@@ -47,12 +157,45 @@ public:
     // Recording functions
     bool startRecording();
     void stopRecording();
-    std::vector<uint8_t> getRecordedAudio();
+    std::vector<uint8_t> getRecordedAudio(uint32_t max_duration_ms = MAX_RECORDING_DURATION * 1000);
     bool isRecording() { return recording; }
     
+    // Records until end-of-speech and returns a WAV trimmed to the utterance
+    std::vector<uint8_t> recordUtterance(uint32_t max_duration_ms = MAX_RECORDING_DURATION * 1000,
+                                         uint32_t no_speech_timeout_ms = VAD_NO_SPEECH_TIMEOUT_MS);
+    
+    // Asynchronous form of the above: the processing task consumes frames
+    // on the other core while the caller waits or does other work
+    bool beginUtterance(uint32_t max_duration_ms = MAX_RECORDING_DURATION * 1000,
+                        uint32_t no_speech_timeout_ms = VAD_NO_SPEECH_TIMEOUT_MS, bool use_vad = true);
+    bool waitUtterance(uint32_t timeout_ms);
+    std::vector<uint8_t> takeUtterance();
+    void setVadConfig(const VadConfig& config) { vad.setConfig(config); }
+    const VoiceActivityDetector& getVad() const { return vad; }
+    
+    // Voice biometrics of the last utterance, computed during capture
+    bool getToneSignature(float tone_signature[VOICE_SIGNATURE_SIZE]) const { return features.getSignature(tone_signature); }
+    size_t featureFrames() const { return features.frameCount(); }
+    PitchStats getPitchStats() const { return pitch.getStats(); }
+    
+    size_t framesQueued() const { return filled_frames.available(); }
+    // Replaces the old frame-pull API: frames are pushed to the observer as
+    // the processing task takes them. Set it before beginUtterance()
+    void setFrameObserver(const CaptureFrameObserver& observer) { frame_observer = observer; }
+    uint32_t droppedSamples() const { return dropped_samples.load(); }
+    
     // Playback functions
     bool playAudio(const std::vector<uint8_t>& audio_data);
     void stopPlayback();
+    bool isSpeakerReady() const { return speaker_initialized; }
+    
+    // Streaming playback: audio starts with the first block written, while
+    // the rest is still arriving. Input is 16 kHz mono 16-bit PCM.
+    bool beginPlaybackStream();
+    bool writePlaybackStream(const uint8_t* data, size_t length);
+    bool endPlaybackStream();
+    bool isStreaming() const { return stream_open.load(); }
+    uint32_t timeToFirstAudioMs() const { return stream_first_audio_ms; }
     
     // WAV file creation
     std::vector<uint8_t> createWAVFile(const std::vector<int16_t>& pcm_data);
@@ -63,16 +206,48 @@ public:
 };
 
 // Implementation
-AudioManager::AudioManager() : mic_initialized(false), speaker_initialized(false), recording(false) {
+AudioManager::AudioManager() : mic_initialized(false), speaker_initialized(false), recording(false),
+                               free_frames(CAPTURE_POOL_FRAMES), filled_frames(CAPTURE_POOL_FRAMES),
+                               capture_task(nullptr), frames_ready(nullptr),
+                               capture_running(false), capture_task_active(false), dropped_samples(0),
+                               capture_gain(dsp_gain_from_float(CAPTURE_GAIN)),
+                               utterance_done(nullptr), processing_task_active(false), utterance_ready(false),
+                               utterance_max_samples(0), utterance_captured(0), utterance_analyzed(0),
+                               utterance_start_time(0), utterance_max_ms(0), utterance_no_speech_ms(0),
+                               utterance_use_vad(true),
+                               playback_stream(PLAYBACK_STREAM_BYTES), free_blocks(nullptr), ready_blocks(nullptr),
+                               stream_data(nullptr), stream_open(false), stream_input_done(false), stream_abort(false),
+                               playback_tasks_active(0), stream_start_time(0), stream_first_audio_ms(0) {
     audio_buffer = (int16_t*)malloc(AUDIO_BUFFER_SIZE * sizeof(int16_t));
+    capture_pool = (int16_t*)malloc(CAPTURE_POOL_FRAMES * CAPTURE_CHUNK_SAMPLES * sizeof(int16_t));
     buffer_size = 0;
 }
 
 AudioManager::~AudioManager() {
+    stopRecording();
+    stopPlayback();
     deinitialize();
     if (audio_buffer) {
         free(audio_buffer);
     }
+    if (capture_pool) {
+        free(capture_pool);
+    }
+    if (frames_ready) {
+        vSemaphoreDelete(frames_ready);
+    }
+    if (utterance_done) {
+        vSemaphoreDelete(utterance_done);
+    }
+    if (free_blocks) {
+        vQueueDelete(free_blocks);
+    }
+    if (ready_blocks) {
+        vQueueDelete(ready_blocks);
+    }
+    if (stream_data) {
+        vSemaphoreDelete(stream_data);
+    }
 }
 
 bool AudioManager::initializeMicrophone() {
@@ -85,8 +260,8 @@ bool AudioManager::initializeMicrophone() {
         .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 512,
+        .dma_buf_count = 8,
+        .dma_buf_len = CAPTURE_CHUNK_SAMPLES,
         .use_apll = false,
         .tx_desc_auto_clear = false,
         .fixed_mclk = 0
@@ -178,51 +353,311 @@ bool AudioManager::startRecording() {
         return false;
     }
     
+    if (recording) {
+        return true;
+    }
+    
+    if (!capture_pool || !free_frames.isAllocated() || !filled_frames.isAllocated() || !audio_buffer) {
+        ESP_LOGE("AUDIO", "Capture buffers not allocated");
+        return false;
+    }
+    
+    if (!frames_ready) {
+        frames_ready = xSemaphoreCreateBinary();
+        if (!frames_ready) {
+            ESP_LOGE("AUDIO", "Failed to create capture semaphore");
+            return false;
+        }
+    }
+    
     ESP_LOGI("AUDIO", "Starting audio recording...");
-    recording = true;
+    
+    // Every frame starts out owned by the free list
+    free_frames.clear();
+    filled_frames.clear();
+    for (uint8_t i = 0; i < CAPTURE_POOL_FRAMES; i++) {
+        free_frames.write(&i, 1);
+    }
+    dropped_samples = 0;
     buffer_size = 0;
+    i2s_zero_dma_buffer(I2S_NUM_0);
     
+    capture_running = true;
+    capture_task_active = true;
+    BaseType_t created = xTaskCreatePinnedToCore(captureTaskEntry, "audio_capture", CAPTURE_TASK_STACK,
+                                                 this, CAPTURE_TASK_PRIORITY, &capture_task, CAPTURE_TASK_CORE);
+    if (created != pdPASS) {
+        ESP_LOGE("AUDIO", "Failed to start capture task");
+        capture_running = false;
+        capture_task_active = false;
+        capture_task = nullptr;
+        return false;
+    }
+    
+    recording = true;
     return true;
 }
 
 void AudioManager::stopRecording() {
+    if (!recording) {
+        return;
+    }
+    
+    // Both tasks notice within one read timeout and exit; a running
+    // processing task still finalizes what it has
+    capture_running = false;
+    while (capture_task_active || processing_task_active) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    capture_task = nullptr;
+    
     recording = false;
-    ESP_LOGI("AUDIO", "Recording stopped. Captured %d samples", buffer_size);
+    ESP_LOGI("AUDIO", "Recording stopped. Captured %d samples, dropped %u", buffer_size, dropped_samples.load());
 }
 
-std::vector<uint8_t> AudioManager::getRecordedAudio() {
-    if (!mic_initialized || !recording) {
-        return std::vector<uint8_t>();
-    }
-    
-    std::vector<int16_t> pcm_data;
-    size_t bytes_read = 0;
-    uint32_t start_time = millis();
+void AudioManager::captureTaskEntry(void* arg) {
+    AudioManager* self = static_cast<AudioManager*>(arg);
+    self->runCapture();
+    self->capture_task_active = false;
+    vTaskDelete(NULL);
+}
+
+void AudioManager::runCapture() {
+    uint8_t index = 0;
+    bool owned = false;
     
-    // Record for specified duration
-    while (recording && (millis() - start_time) < (MAX_RECORDING_DURATION * 1000)) {
-        int16_t samples[AUDIO_BUFFER_SIZE];
+    while (capture_running) {
+        if (!owned) {
+            owned = free_frames.read(&index, 1) == 1;
+        }
         
-        esp_err_t result = i2s_read(I2S_NUM_0, samples, sizeof(samples), &bytes_read, portMAX_DELAY);
-        if (result == ESP_OK && bytes_read > 0) {
-            size_t samples_read = bytes_read / sizeof(int16_t);
-            
-            // Apply gain and filtering
-            for (size_t i = 0; i < samples_read; i++) {
-                int32_t amplified = samples[i] * 4; // 4x amplification
-                samples[i] = constrain(amplified, -32768, 32767);
+        // DMA lands directly in the pool frame. With the pool exhausted the
+        // I2S FIFO still has to be drained, so that audio is read and dropped
+        int16_t* frame = owned ? capture_pool + (size_t)index * CAPTURE_CHUNK_SAMPLES : audio_buffer;
+        size_t bytes_read = 0;
+        
+        // Blocks on DMA completion only; no sleeping between reads
+        esp_err_t result = i2s_read(I2S_NUM_0, frame, CAPTURE_CHUNK_SAMPLES * sizeof(int16_t),
+                                    &bytes_read, pdMS_TO_TICKS(CAPTURE_READ_TIMEOUT_MS));
+        if (result != ESP_OK || bytes_read == 0) {
+            continue;
+        }
+        
+        size_t samples_read = bytes_read / sizeof(int16_t);
+        if (!owned) {
+            dropped_samples += samples_read;
+            continue;
+        }
+        
+        dsp_apply_gain(frame, samples_read, capture_gain);
+        
+        // Publishing the index hands the frame to the processing task
+        frame_lengths[index] = (uint16_t)samples_read;
+        filled_frames.write(&index, 1);
+        owned = false;
+        
+        xSemaphoreGive(frames_ready);
+    }
+}
+
+bool AudioManager::beginUtterance(uint32_t max_duration_ms, uint32_t no_speech_timeout_ms, bool use_vad) {
+    if (!mic_initialized || !recording || processing_task_active) {
+        return false;
+    }
+    
+    if (!utterance_done) {
+        utterance_done = xSemaphoreCreateBinary();
+        if (!utterance_done) {
+            ESP_LOGE("AUDIO", "Failed to create utterance semaphore");
+            return false;
+        }
+    }
+    xSemaphoreTake(utterance_done, 0);
+    
+    // Sized once up front so the session never reallocates; PCM lands
+    // directly behind the reserved WAV header
+    utterance_max_samples = (size_t)SAMPLE_RATE * max_duration_ms / 1000;
+    utterance_wav = wav_allocate(utterance_max_samples);
+    if (utterance_wav.empty()) {
+        ESP_LOGE("AUDIO", "Failed to allocate utterance buffer");
+        return false;
+    }
+    utterance_captured = 0;
+    utterance_analyzed = 0;
+    utterance_start_time = millis();
+    utterance_max_ms = max_duration_ms;
+    utterance_no_speech_ms = no_speech_timeout_ms;
+    utterance_use_vad = use_vad;
+    utterance_ready = false;
+    
+    vad.reset();
+    features.reset();
+    pitch.reset();
+    
+    processing_task_active = true;
+    if (xTaskCreatePinnedToCore(processingTaskEntry, "audio_process", PROCESSING_TASK_STACK, this,
+                                PROCESSING_TASK_PRIORITY, nullptr, PROCESSING_TASK_CORE) != pdPASS) {
+        ESP_LOGE("AUDIO", "Failed to start processing task");
+        processing_task_active = false;
+        return false;
+    }
+    return true;
+}
+
+bool AudioManager::waitUtterance(uint32_t timeout_ms) {
+    if (utterance_ready) {
+        return true;
+    }
+    if (utterance_done) {
+        xSemaphoreTake(utterance_done, pdMS_TO_TICKS(timeout_ms));
+    }
+    return utterance_ready;
+}
+
+std::vector<uint8_t> AudioManager::takeUtterance() {
+    while (processing_task_active && !utterance_ready) {
+        waitUtterance(CAPTURE_READ_TIMEOUT_MS);
+    }
+    stopRecording();
+    utterance_ready = false;
+    return std::move(utterance_wav);
+}
+
+void AudioManager::processingTaskEntry(void* arg) {
+    AudioManager* self = static_cast<AudioManager*>(arg);
+    self->runProcessing();
+    self->processing_task_active = false;
+    vTaskDelete(NULL);
+}
+
+void AudioManager::runProcessing() {
+    bool complete = false;
+    
+    while (!complete) {
+        uint8_t index;
+        if (filled_frames.read(&index, 1) == 0) {
+            if (!capture_running) {
+                break;
             }
-            
-            pcm_data.insert(pcm_data.end(), samples, samples + samples_read);
+            xSemaphoreTake(frames_ready, pdMS_TO_TICKS(CAPTURE_READ_TIMEOUT_MS));
+            complete = utteranceComplete();
+            continue;
         }
         
-        delay(10); // Small delay to prevent watchdog
+        consumeFrame(capture_pool + (size_t)index * CAPTURE_CHUNK_SAMPLES, frame_lengths[index]);
+        free_frames.write(&index, 1);   // ownership back to the capture task
+        complete = utteranceComplete();
     }
     
-    recording = false;
+    // Stop the producer, then return whatever it still queued to the pool
+    capture_running = false;
+    while (capture_task_active) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    uint8_t index;
+    while (filled_frames.read(&index, 1) == 1) {
+        free_frames.write(&index, 1);
+    }
+    
+    finalizeUtterance();
+    utterance_ready = true;
+    xSemaphoreGive(utterance_done);
+}
+
+void AudioManager::consumeFrame(const int16_t* frame, size_t samples) {
+    if (frame_observer) {
+        frame_observer(frame, samples);
+    }
+    
+    int16_t* pcm = wav_samples(utterance_wav);
+    size_t room = utterance_max_samples - utterance_captured;
+    if (samples > room) {
+        samples = room;
+    }
+    
+    // The one copy in the pipeline: into the contiguous buffer STT uploads
+    memcpy(pcm + utterance_captured, frame, samples * sizeof(int16_t));
+    utterance_captured += samples;
+    buffer_size = utterance_captured;
+    
+    if (!utterance_use_vad) {
+        return;
+    }
+    
+    // Run the detector and feature extraction over every complete frame
+    // as it arrives, so the signature is ready when speech ends
+    const size_t frame_samples = vad.getConfig().frame_samples;
+    while (utterance_captured - utterance_analyzed >= frame_samples) {
+        const int16_t* vad_frame = pcm + utterance_analyzed;
+        if (vad.processFrame(vad_frame, frame_samples) == VAD_SPEECH) {
+            features.pushSamples(vad_frame, frame_samples);
+            pitch.pushSamples(vad_frame, frame_samples);
+        }
+        utterance_analyzed += frame_samples;
+    }
+}
+
+bool AudioManager::utteranceComplete() {
+    if (utterance_captured >= utterance_max_samples) {
+        return true;
+    }
+    
+    uint32_t elapsed = millis() - utterance_start_time;
+    if (elapsed >= utterance_max_ms) {
+        return true;
+    }
+    if (!utterance_use_vad) {
+        return false;
+    }
+    if (!vad.speechDetected() && elapsed >= utterance_no_speech_ms) {
+        ESP_LOGI("AUDIO", "No speech within %u ms", utterance_no_speech_ms);
+        return true;
+    }
+    return vad.speechEnded();
+}
+
+void AudioManager::finalizeUtterance() {
+    int16_t* pcm = wav_samples(utterance_wav);
     
-    // Convert to WAV format
-    return createWAVFile(pcm_data);
+    if (!utterance_use_vad) {
+        wav_finalize(utterance_wav, utterance_captured, SAMPLE_RATE);
+        return;
+    }
+    
+    if (!vad.speechDetected()) {
+        utterance_wav.clear();
+        return;
+    }
+    
+    // Trim leading and trailing silence in place, then patch the header
+    size_t start = vad.speechStartSample();
+    size_t end = vad.speechEndSample();
+    if (end > utterance_captured) {
+        end = utterance_captured;
+    }
+    size_t kept = end - start;
+    if (start > 0) {
+        memmove(pcm, pcm + start, kept * sizeof(int16_t));
+    }
+    dsp_remove_dc(pcm, kept);
+    wav_finalize(utterance_wav, kept, SAMPLE_RATE);
+    
+    ESP_LOGI("AUDIO", "Utterance: %u ms kept of %u ms captured",
+             (unsigned)(kept * 1000 / SAMPLE_RATE), (unsigned)(utterance_captured * 1000 / SAMPLE_RATE));
+}
+
+std::vector<uint8_t> AudioManager::getRecordedAudio(uint32_t max_duration_ms) {
+    if (!beginUtterance(max_duration_ms, max_duration_ms, false)) {
+        return std::vector<uint8_t>();
+    }
+    return takeUtterance();
+}
+
+std::vector<uint8_t> AudioManager::recordUtterance(uint32_t max_duration_ms, uint32_t no_speech_timeout_ms) {
+    if (!beginUtterance(max_duration_ms, no_speech_timeout_ms)) {
+        return std::vector<uint8_t>();
+    }
+    return takeUtterance();
 }
 
 bool AudioManager::playAudio(const std::vector<uint8_t>& audio_data) {
@@ -233,111 +668,241 @@ bool AudioManager::playAudio(const std::vector<uint8_t>& audio_data) {
     
     ESP_LOGI("AUDIO", "Playing audio data (%d bytes)", audio_data.size());
     
-    // Skip WAV header if present (44 bytes)
+    // Skip WAV header and any extra chunks if present
     size_t data_offset = 0;
-    if (audio_data.size() > 44 && 
-        audio_data[0] == 'R' && audio_data[1] == 'I' && 
-        audio_data[2] == 'F' && audio_data[3] == 'F') {
-        data_offset = 44;
+    size_t total_bytes = audio_data.size();
+    wav_find_data(audio_data.data(), audio_data.size(), &data_offset, &total_bytes);
+    
+    // Same path as streamed audio, so mono PCM is expanded for the stereo DAC
+    if (!beginPlaybackStream()) {
+        return false;
+    }
+    bool ok = writePlaybackStream(audio_data.data() + data_offset, total_bytes);
+    ok = endPlaybackStream() && ok;
+    
+    ESP_LOGI("AUDIO", "Audio playback completed");
+    return ok;
+}
+
+bool AudioManager::beginPlaybackStream() {
+    if (!speaker_initialized) {
+        ESP_LOGE("AUDIO", "Speaker not initialized");
+        return false;
     }
     
-    size_t bytes_written = 0;
-    size_t total_bytes = audio_data.size() - data_offset;
-    const uint8_t* data_ptr = audio_data.data() + data_offset;
+    if (stream_open) {
+        stopPlayback();
+    }
     
-    while (bytes_written < total_bytes) {
-        size_t chunk_size = min(1024UL, total_bytes - bytes_written);
-        size_t written = 0;
-        
-        esp_err_t result = i2s_write(I2S_NUM_1, data_ptr + bytes_written, chunk_size, &written, portMAX_DELAY);
-        if (result != ESP_OK) {
-            ESP_LOGE("AUDIO", "I2S write failed: %s", esp_err_to_name(result));
+    if (!playback_stream.isAllocated()) {
+        ESP_LOGE("AUDIO", "Playback buffers not allocated");
+        return false;
+    }
+    
+    if (!free_blocks) {
+        free_blocks = xQueueCreate(PLAYBACK_BLOCKS, sizeof(uint8_t));
+        ready_blocks = xQueueCreate(PLAYBACK_BLOCKS + 1, sizeof(PlaybackBlock));
+        stream_data = xSemaphoreCreateBinary();
+        if (!free_blocks || !ready_blocks || !stream_data) {
+            ESP_LOGE("AUDIO", "Failed to create playback queues");
             return false;
         }
-        
-        bytes_written += written;
-        delay(1); // Prevent watchdog
     }
     
-    ESP_LOGI("AUDIO", "Audio playback completed");
+    playback_stream.clear();
+    xQueueReset(free_blocks);
+    xQueueReset(ready_blocks);
+    for (uint8_t i = 0; i < PLAYBACK_BLOCKS; i++) {
+        xQueueSend(free_blocks, &i, 0);
+    }
+    
+    stream_input_done = false;
+    stream_abort = false;
+    stream_start_time = millis();
+    stream_first_audio_ms = 0;
+    
+    playback_tasks_active = 2;
+    if (xTaskCreatePinnedToCore(decoderTaskEntry, "audio_decode", PLAYBACK_TASK_STACK, this,
+                                PLAYBACK_TASK_PRIORITY, nullptr, PLAYBACK_TASK_CORE) != pdPASS) {
+        ESP_LOGE("AUDIO", "Failed to start decoder task");
+        playback_tasks_active = 0;
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(outputTaskEntry, "audio_output", PLAYBACK_TASK_STACK, this,
+                                PLAYBACK_TASK_PRIORITY + 1, nullptr, PLAYBACK_TASK_CORE) != pdPASS) {
+        ESP_LOGE("AUDIO", "Failed to start output task");
+        playback_tasks_active--;
+        stream_abort = true;
+        xSemaphoreGive(stream_data);
+        waitForPlaybackTasks();
+        return false;
+    }
+    
+    stream_open = true;
     return true;
 }
 
+bool AudioManager::writePlaybackStream(const uint8_t* data, size_t length) {
+    if (!stream_open) {
+        return false;
+    }
+    
+    // Back-pressure: when the queue is full the caller (the network reader)
+    // waits here instead of buffering the whole response
+    while (length > 0) {
+        if (stream_abort) {
+            return false;
+        }
+        size_t written = playback_stream.write(data, length);
+        if (written > 0) {
+            data += written;
+            length -= written;
+            xSemaphoreGive(stream_data);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(2));
+        }
+    }
+    return true;
+}
+
+bool AudioManager::endPlaybackStream() {
+    if (!stream_open) {
+        return false;
+    }
+    
+    // Let the decoder drain whatever is queued, then wait for the DAC
+    stream_input_done = true;
+    xSemaphoreGive(stream_data);
+    waitForPlaybackTasks();
+    stream_open = false;
+    
+    ESP_LOGI("AUDIO", "Stream played, first audio after %u ms", stream_first_audio_ms);
+    return !stream_abort;
+}
+
+void AudioManager::waitForPlaybackTasks() {
+    while (playback_tasks_active > 0) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+}
+
+void AudioManager::decoderTaskEntry(void* arg) {
+    AudioManager* self = static_cast<AudioManager*>(arg);
+    self->runDecoder();
+    self->playback_tasks_active--;
+    vTaskDelete(NULL);
+}
+
+void AudioManager::outputTaskEntry(void* arg) {
+    AudioManager* self = static_cast<AudioManager*>(arg);
+    self->runOutput();
+    self->playback_tasks_active--;
+    vTaskDelete(NULL);
+}
+
+void AudioManager::runDecoder() {
+    // Incoming bytes are already linear PCM, so decoding is a copy into the
+    // next free block; a block is handed over as soon as it fills, which
+    // bounds time-to-first-audio by one block rather than the whole response
+    while (!stream_abort) {
+        uint8_t index;
+        if (xQueueReceive(free_blocks, &index, pdMS_TO_TICKS(CAPTURE_READ_TIMEOUT_MS)) != pdTRUE) {
+            continue;
+        }
+        
+        uint8_t* block = reinterpret_cast<uint8_t*>(playback_blocks[index]);
+        const size_t block_bytes = PLAYBACK_BLOCK_SAMPLES * sizeof(int16_t);
+        size_t filled = 0;
+        bool finished = false;
+        
+        while (filled < block_bytes && !stream_abort) {
+            size_t got = playback_stream.read(block + filled, block_bytes - filled);
+            filled += got;
+            if (got == 0) {
+                if (stream_input_done && playback_stream.available() == 0) {
+                    finished = true;
+                    break;
+                }
+                xSemaphoreTake(stream_data, pdMS_TO_TICKS(CAPTURE_READ_TIMEOUT_MS));
+            }
+        }
+        
+        PlaybackBlock ready = {index, (uint16_t)(filled / sizeof(int16_t))};
+        if (ready.samples > 0 && !stream_abort) {
+            xQueueSend(ready_blocks, &ready, portMAX_DELAY);
+        }
+        if (finished || stream_abort) {
+            break;
+        }
+    }
+    
+    PlaybackBlock end_marker = {0, 0};
+    xQueueSend(ready_blocks, &end_marker, portMAX_DELAY);
+}
+
+void AudioManager::runOutput() {
+    while (true) {
+        PlaybackBlock block;
+        if (xQueueReceive(ready_blocks, &block, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (block.samples == 0) {
+            break;
+        }
+        
+        if (stream_first_audio_ms == 0) {
+            stream_first_audio_ms = millis() - stream_start_time;
+        }
+        
+        // The speaker runs RIGHT_LEFT, so each mono sample feeds both channels
+        const int16_t* pcm = playback_blocks[block.index];
+        for (size_t offset = 0; offset < block.samples && !stream_abort; offset += PLAYBACK_WRITE_SAMPLES) {
+            size_t frames = min((size_t)PLAYBACK_WRITE_SAMPLES, (size_t)block.samples - offset);
+            for (size_t i = 0; i < frames; i++) {
+                playback_frames[2 * i] = pcm[offset + i];
+                playback_frames[2 * i + 1] = pcm[offset + i];
+            }
+            
+            size_t written = 0;
+            esp_err_t result = i2s_write(I2S_NUM_1, playback_frames, frames * 2 * sizeof(int16_t),
+                                         &written, portMAX_DELAY);
+            if (result != ESP_OK) {
+                ESP_LOGE("AUDIO", "I2S write failed: %s", esp_err_to_name(result));
+                stream_abort = true;
+            }
+        }
+        
+        // Block is free for the decoder again while DMA plays this one out
+        xQueueSend(free_blocks, &block.index, 0);
+    }
+}
+
 void AudioManager::stopPlayback() {
+    if (stream_open) {
+        stream_abort = true;
+        xSemaphoreGive(stream_data);
+        waitForPlaybackTasks();
+        stream_open = false;
+    }
     if (speaker_initialized) {
         i2s_zero_dma_buffer(I2S_NUM_1);
     }
 }
 
 std::vector<uint8_t> AudioManager::createWAVFile(const std::vector<int16_t>& pcm_data) {
-    std::vector<uint8_t> wav_file;
-    
-    // WAV header
-    uint32_t file_size = pcm_data.size() * 2 + 36;
-    uint32_t data_size = pcm_data.size() * 2;
-    
-    // RIFF header
-    wav_file.insert(wav_file.end(), {'R', 'I', 'F', 'F'});
-    wav_file.push_back(file_size & 0xFF);
-    wav_file.push_back((file_size >> 8) & 0xFF);
-    wav_file.push_back((file_size >> 16) & 0xFF);
-    wav_file.push_back((file_size >> 24) & 0xFF);
-    wav_file.insert(wav_file.end(), {'W', 'A', 'V', 'E'});
-    
-    // Format chunk
-    wav_file.insert(wav_file.end(), {'f', 'm', 't', ' '});
-    wav_file.insert(wav_file.end(), {16, 0, 0, 0}); // Chunk size
-    wav_file.insert(wav_file.end(), {1, 0}); // PCM format
-    wav_file.insert(wav_file.end(), {1, 0}); // Mono
-    
-    // Sample rate
-    wav_file.push_back(SAMPLE_RATE & 0xFF);
-    wav_file.push_back((SAMPLE_RATE >> 8) & 0xFF);
-    wav_file.push_back((SAMPLE_RATE >> 16) & 0xFF);
-    wav_file.push_back((SAMPLE_RATE >> 24) & 0xFF);
-    
-    // Byte rate
-    uint32_t byte_rate = SAMPLE_RATE * 2;
-    wav_file.push_back(byte_rate & 0xFF);
-    wav_file.push_back((byte_rate >> 8) & 0xFF);
-    wav_file.push_back((byte_rate >> 16) & 0xFF);
-    wav_file.push_back((byte_rate >> 24) & 0xFF);
-    
-    wav_file.insert(wav_file.end(), {2, 0}); // Block align
-    wav_file.insert(wav_file.end(), {16, 0}); // Bits per sample
-    
-    // Data chunk
-    wav_file.insert(wav_file.end(), {'d', 'a', 't', 'a'});
-    wav_file.push_back(data_size & 0xFF);
-    wav_file.push_back((data_size >> 8) & 0xFF);
-    wav_file.push_back((data_size >> 16) & 0xFF);
-    wav_file.push_back((data_size >> 24) & 0xFF);
-    
-    // PCM data
-    for (int16_t sample : pcm_data) {
-        wav_file.push_back(sample & 0xFF);
-        wav_file.push_back((sample >> 8) & 0xFF);
-    }
-    
+    // Single allocation and a single copy of the PCM payload
+    std::vector<uint8_t> wav_file = wav_allocate(pcm_data.size());
+    memcpy(wav_samples(wav_file), pcm_data.data(), pcm_data.size() * sizeof(int16_t));
+    wav_finalize(wav_file, pcm_data.size(), SAMPLE_RATE);
     return wav_file;
 }
 
 void AudioManager::amplifyAudio(std::vector<int16_t>& audio_data, float gain) {
-    for (int16_t& sample : audio_data) {
-        int32_t amplified = (int32_t)(sample * gain);
-        sample = constrain(amplified, -32768, 32767);
-    }
+    dsp_apply_gain(audio_data.data(), audio_data.size(), dsp_gain_from_float(gain));
 }
 
 float AudioManager::calculateRMS(const std::vector<int16_t>& audio_data) {
-    if (audio_data.empty()) return 0.0f;
-    
-    float sum_squares = 0.0f;
-    for (int16_t sample : audio_data) {
-        sum_squares += (float)(sample * sample);
-    }
-    
-    return sqrt(sum_squares / audio_data.size());
+    return dsp_rms(audio_data.data(), audio_data.size());
 }
 
 #endif // AUDIO_MANAGER_H
\ No newline at end of file
@@ -8,10 +8,18 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <LittleFS.h>
 
 // Include your existing modules
 #include "voice_processor.h"
+#include "voice_matcher.h"
+#include "storage_manager.h"
 #include "error_handler.h"
+#include "phrase_cache.h"
+#include "audio_codec.h"
+#include "i2c_communication.h"
+#include "profile_replication.h"
+#include "display_manager.h"
 
 // Include audio manager for real voice processing
 #include "audio_manager.h"
@@ -22,26 +30,26 @@
 // Enable real audio processing (set to false for simulation)
 #define USE_REAL_AUDIO true
 
+// Enrollment recordings are kept compressed on flash, one file per number
+#define ENROLLMENT_ARCHIVE_DIR "/enroll"
+#define ENROLLMENT_ARCHIVE_FORMAT AUDIO_FORMAT_ADPCM_8K
+
 // Global objects
 AudioManager audio_manager;
+PhraseCache phrase_cache;
+std::vector<int16_t> announcement_pcm;  // reused so announcements don't reallocate
 
 // Demo data
-uint16_t demo_numbers[] = {42, 123, 456, 789, 101, 234, 567, 890};
-int current_demo_index = 0;
 bool wifi_connected = false;
 bool api_enabled = false;
 bool audio_ready = false;
 
-// Voice profiles for demo
-struct VoiceProfileDemo {
-    String keyword;
-    uint32_t voice_hash;
-    uint16_t number;
-    bool active;
-};
+// Biometrics and recording of the most recent utterance, filled by processVoiceInput()
+VoiceFeatures last_voice_features = {0.0f, {0}};
+std::vector<uint8_t> last_utterance_audio;
 
-VoiceProfileDemo registered_users[10];
-int registered_count = 0;
+// Stand-in biometrics for simulation mode (one consistent "speaker")
+const VoiceFeatures simulated_voice_features = {185.5f, {-18.6f, -14.9f, -10.1f, -4.9f, -15.5f, -22.9f, -11.9f, 3.8f}};
 
 // Function prototypes
 void initializeSystem();
@@ -50,8 +58,12 @@ void handleRetrieval();
 void updateDisplay(const char* status, int color = WHITE, const char* extra = "");
 String processVoiceInput(bool use_real_audio = USE_REAL_AUDIO);
 uint32_t calculateVoiceHash(const String& keyword, const std::vector<uint8_t>& audio_data = {});
-bool findMatchingUser(const String& keyword, uint32_t voice_hash, uint16_t& found_number);
+bool findMatchingUser(const String& keyword, const VoiceFeatures& features, uint16_t& found_number, float& confidence,
+                      int* found_slot = nullptr);
 void provideAudioFeedback(const String& message);
+void announceNumber(PhrasePrefix prefix, uint16_t number, const String& message);
+bool provisionPhraseCache();
+void archiveEnrollmentAudio(uint16_t number);
 
 void setup() {
     Serial.begin(115200);
@@ -89,13 +101,13 @@ void loop() {
     
     if (M5.BtnC.wasPressed()) {
         Serial.println("\n📊 === SYSTEM INFO ===");
-        Serial.printf("Registered Users: %d\n", registered_count);
-        Serial.printf("Next Number: %d\n", demo_numbers[current_demo_index]);
+        Serial.printf("Registered Users: %d\n", active_profile_count());
+        Serial.printf("Free Numbers: %d\n", assignment_numbers_available());
         Serial.printf("Free Memory: %d bytes\n", ESP.getFreeHeap());
         Serial.printf("Uptime: %lu seconds\n", millis() / 1000);
         Serial.printf("Audio Buffer Size: %d bytes\n", AUDIO_BUFFER_SIZE * 2);
         
-        updateDisplay("INFO", CYAN, String(registered_count).c_str());
+        updateDisplay("INFO", CYAN, String(active_profile_count()).c_str());
         delay(2000);
         updateDisplay("READY", GREEN);
     }
@@ -111,6 +123,8 @@ void initializeSystem() {
     cfg.clear_display = true;
     M5.begin(cfg);
     
+    const DisplayLayout layout = {5, 8, 32, 60, 88};
+    display_begin(layout);
     updateDisplay("STARTING...", YELLOW);
     
     // Initialize audio system
@@ -149,6 +163,8 @@ void initializeSystem() {
         if (WiFi.status() == WL_CONNECTED) {
             wifi_connected = true;
             Serial.printf("\n✅ WiFi connected! IP: %s\n", WiFi.localIP().toString().c_str());
+            // Wall clock for profile timestamps; storage re-ages restored rows once it is set
+            configTime(0, 0, PROFILE_NTP_SERVER);
             
             // Test ElevenLabs API
             if (strlen(ELEVENLABS_API_KEY) > 10 && strcmp(ELEVENLABS_API_KEY, "YOUR_API_KEY_HERE") != 0) {
@@ -164,6 +180,28 @@ void initializeSystem() {
         Serial.println("⚠️  WiFi credentials not configured");
     }
     
+    // Prerendered announcements; rendered once while online, then used offline
+    if (LittleFS.begin(true)) {
+        // Guests registered before a reboot or brownout come back first
+        storage_begin();
+        Serial.printf("✅ Profile store restored (%d active)\n", active_profile_count());
+        
+        // The Feather keeps a replica for lookups and staff queries
+        if (i2c_begin_controller() && replication_begin()) {
+            Serial.println("✅ Profile replication to Feather started");
+        }
+        
+        if (phrase_cache.open()) {
+            Serial.printf("✅ Phrase cache loaded (%u clips)\n", (unsigned)phrase_cache.clipCount());
+        } else if (api_enabled && provisionPhraseCache()) {
+            Serial.println("✅ Phrase cache provisioned");
+        } else {
+            Serial.println("⚠️  No phrase cache - announcements use live TTS");
+        }
+    } else {
+        Serial.println("⚠️  LittleFS mount failed");
+    }
+    
     Serial.println("✅ System initialization complete");
     log_exit("initializeSystem");
 }
@@ -194,29 +232,31 @@ void handleRegistration() {
     
     // Check if already registered
     uint16_t existing_number;
-    if (findMatchingUser(recognized_keyword, voice_hash, existing_number)) {
-        Serial.printf("👤 User already registered with number: %d\n", existing_number);
+    float confidence;
+    if (findMatchingUser(recognized_keyword, last_voice_features, existing_number, confidence)) {
+        Serial.printf("👤 User already registered with number: %d (%.0f%% match)\n", existing_number, confidence * 100.0f);
         updateDisplay("EXISTING", ORANGE, String(existing_number).c_str());
         
-        provideAudioFeedback("You are already registered as number " + String(existing_number));
+        announceNumber(PHRASE_ALREADY_REGISTERED, existing_number,
+                       "You are already registered as number " + String(existing_number));
         delay(3000);
         updateDisplay("READY", GREEN);
         log_exit("handleRegistration");
         return;
     }
     
-    // Register new user
-    if (registered_count < 10) {
-        uint16_t assigned_number = demo_numbers[current_demo_index];
-        current_demo_index = (current_demo_index + 1) % 8;
-        
-        registered_users[registered_count] = {
-            recognized_keyword,
-            voice_hash, 
-            assigned_number,
-            true
-        };
-        registered_count++;
+    // Register new user; storage draws the number from the pool
+    VoiceProfile profile = {};
+    strncpy(profile.keyword, recognized_keyword.c_str(), sizeof(profile.keyword) - 1);
+    profile.voice_hash = voice_hash;
+    profile.pitch_average = last_voice_features.pitch_average;
+    memcpy(profile.tone_signature, last_voice_features.tone_signature, sizeof(profile.tone_signature));
+    profile.timestamp = profile_timestamp_now();
+    profile.active = true;
+    
+    uint16_t assigned_number = add_voice_profile(profile);
+    if (assigned_number) {
+        archiveEnrollmentAudio(assigned_number);
         
         Serial.printf("✅ NEW USER REGISTERED:\n");
         Serial.printf("   Keyword: %s\n", recognized_keyword.c_str());
@@ -225,11 +265,11 @@ void handleRegistration() {
         
         updateDisplay("ASSIGNED", GREEN, String(assigned_number).c_str());
         
-        provideAudioFeedback("Your items are stored as number " + String(assigned_number));
+        announceNumber(PHRASE_STORED, assigned_number, "Your items are stored as number " + String(assigned_number));
         
         // Log performance metrics
         log_performance("registration_success", 1.0f);
-        log_performance("total_users", (float)registered_count);
+        log_performance("total_users", (float)active_profile_count());
         
         delay(4000);
     } else {
@@ -263,24 +303,26 @@ void handleRetrieval() {
     
     updateDisplay("MATCHING", PURPLE, "Verifying");
     
-    // Calculate voice hash for matching
-    uint32_t spoken_hash = calculateVoiceHash(spoken_keyword);
-    
-    // Find matching profile
+    // Score the voice against every profile registered with this keyword
     uint16_t found_number;
-    if (findMatchingUser(spoken_keyword, spoken_hash, found_number)) {
+    float confidence;
+    int found_slot;
+    if (findMatchingUser(spoken_keyword, last_voice_features, found_number, confidence, &found_slot)) {
         Serial.printf("✅ AUTHENTICATION SUCCESS:\n");
-        Serial.printf("   Voice verified for number: %d\n", found_number);
+        Serial.printf("   Voice verified for number: %d (%.0f%% confidence)\n", found_number, confidence * 100.0f);
+        
+        // Items collected: the number is free for the next guest
+        deactivate_profile_slot(found_slot);
         
         updateDisplay("FOUND", GREEN, String(found_number).c_str());
         
-        provideAudioFeedback("Your items are number " + String(found_number));
+        announceNumber(PHRASE_RETRIEVE, found_number, "Your items are number " + String(found_number));
         
         log_performance("retrieval_success", 1.0f);
         delay(4000);
     } else {
         Serial.println("❌ AUTHENTICATION FAILED:");
-        Serial.println("   Voice not recognized or user not registered");
+        Serial.printf("   Best confidence %.0f%% (threshold %.0f%%)\n", confidence * 100.0f, get_match_threshold() * 100.0f);
         
         updateDisplay("NOT FOUND", RED, "Register?");
         
@@ -297,20 +339,38 @@ String processVoiceInput(bool use_real_audio) {
     
     String result = "";
     std::vector<uint8_t> audio_data;
+    last_utterance_audio.clear();
+    // Never let a failed capture fall back on the previous guest's voice
+    last_voice_features = VoiceFeatures{0.0f, {0}};
     
     if (use_real_audio && audio_ready) {
         Serial.println("🎙️  Recording real audio...");
         
         // Start recording
-        if (audio_manager.startRecording()) {
-            delay(3000); // Record for 3 seconds
-            audio_manager.stopRecording();
+        if (audio_manager.startRecording() && audio_manager.beginUtterance()) {
+            // Capture (core 0) and analysis (core 1) run on their own tasks
+            // until the guest stops talking; keep the buttons serviced meanwhile
+            while (!audio_manager.waitUtterance(50)) {
+                M5.update();
+            }
+            audio_data = audio_manager.takeUtterance();
             
-            // Get recorded audio
-            audio_data = audio_manager.getRecordedAudio();
+            if (audio_manager.droppedSamples() > 0) {
+                Serial.printf("⚠️  Capture dropped %u samples\n", audio_manager.droppedSamples());
+            }
             
-            if (audio_data.size() > 0) {
+            if (audio_data.size() > 0 && !audio_manager.getToneSignature(last_voice_features.tone_signature)) {
+                // Too little speech for MFCC frames: no signature to register or match with
+                Serial.println("❌ No voice signature in capture");
+            } else if (audio_data.size() > 0) {
                 Serial.printf("📊 Captured %d bytes of audio\n", audio_data.size());
+                Serial.printf("🧬 Voice signature from %d frames\n", audio_manager.featureFrames());
+                
+                PitchStats pitch = audio_manager.getPitchStats();
+                Serial.printf("🎵 Pitch: %.1f Hz (sd %.1f), %.0f%% voiced\n",
+                              pitch.mean_hz, sqrtf(pitch.variance_hz2), pitch.voiced_ratio * 100.0f);
+                
+                last_voice_features.pitch_average = pitch.mean_hz;
                 
                 if (api_enabled && wifi_connected) {
                     // Process with ElevenLabs
@@ -321,10 +381,12 @@ String processVoiceInput(bool use_real_audio) {
                     result = "Helsinki winter";
                     Serial.println("🔄 Simulated recognition (no API)");
                 }
+                last_utterance_audio = std::move(audio_data);
             } else {
                 Serial.println("❌ No audio data captured");
             }
         } else {
+            audio_manager.stopRecording();
             Serial.println("❌ Failed to start recording");
         }
     } else {
@@ -332,6 +394,7 @@ String processVoiceInput(bool use_real_audio) {
         Serial.println("🔄 Voice simulation mode");
         delay(2000); // Simulate recording time
         result = "Helsinki winter"; // Demo keyword
+        last_voice_features = simulated_voice_features;
     }
     
     log_exit("processVoiceInput");
@@ -364,18 +427,19 @@ uint32_t calculateVoiceHash(const String& keyword, const std::vector<uint8_t>& a
     return hash;
 }
 
-bool findMatchingUser(const String& keyword, uint32_t voice_hash, uint16_t& found_number) {
+bool findMatchingUser(const String& keyword, const VoiceFeatures& features, uint16_t& found_number, float& confidence,
+                      int* found_slot) {
     log_entry("findMatchingUser");
     
-    for (int i = 0; i < registered_count; i++) {
-        if (registered_users[i].active && 
-            registered_users[i].keyword.equals(keyword) && 
-            registered_users[i].voice_hash == voice_hash) {
-            
-            found_number = registered_users[i].number;
-            log_exit("findMatchingUser");
-            return true;
+    // Scores everyone registered under this keyword in one batch
+    int slot = match_voice_profile(keyword.c_str(), features, &confidence);
+    if (slot >= 0) {
+        found_number = profile_assignment_number(slot);
+        if (found_slot) {
+            *found_slot = slot;
         }
+        log_exit("findMatchingUser");
+        return true;
     }
     
     log_exit("findMatchingUser");
@@ -388,14 +452,17 @@ void provideAudioFeedback(const String& message) {
     Serial.printf("🔊 Audio Feedback: '%s'\n", message.c_str());
     
     if (api_enabled && wifi_connected) {
-        // Generate TTS with ElevenLabs
-        std::vector<uint8_t> tts_audio = elevenlabs_text_to_speech(message.c_str());
-        
-        if (tts_audio.size() > 0 && audio_ready) {
-            Serial.println("🎵 Playing TTS audio...");
-            audio_manager.playAudio(tts_audio);
+        if (audio_manager.isSpeakerReady() && audio_manager.beginPlaybackStream()) {
+            // Playback starts with the first PCM block off the network
+            Serial.println("🎵 Streaming TTS audio...");
+            bool streamed = elevenlabs_text_to_speech_stream(message.c_str(), [](const uint8_t* data, size_t length) {
+                return audio_manager.writePlaybackStream(data, length);
+            });
+            audio_manager.endPlaybackStream();
+            Serial.printf("🎵 TTS %s, first audio after %u ms\n", streamed ? "played" : "interrupted",
+                          audio_manager.timeToFirstAudioMs());
         } else {
-            Serial.println("🔄 TTS generated but no speaker available");
+            Serial.println("🔄 No speaker available for TTS");
         }
     } else {
         Serial.println("🔄 TTS simulation mode (no API)");
@@ -404,23 +471,86 @@ void provideAudioFeedback(const String& message) {
     log_exit("provideAudioFeedback");
 }
 
-void updateDisplay(const char* status, int color, const char* extra) {
-    M5.Display.fillScreen(BLACK);
-    M5.Display.setTextColor(color);
-    M5.Display.setTextSize(2);
+void announceNumber(PhrasePrefix prefix, uint16_t number, const String& message) {
+    log_entry("announceNumber");
+    
+    // Assembled from flash when possible: no network round trip
+    if (phrase_cache.isOpen() && audio_manager.isSpeakerReady() &&
+        phrase_cache.renderAnnouncement(prefix, number, announcement_pcm)) {
+        Serial.printf("🔊 Cached announcement: '%s'\n", message.c_str());
+        if (audio_manager.beginPlaybackStream()) {
+            audio_manager.writePlaybackStream(reinterpret_cast<const uint8_t*>(announcement_pcm.data()),
+                                              announcement_pcm.size() * sizeof(int16_t));
+            audio_manager.endPlaybackStream();
+        }
+        log_performance("phrase_cache_hit", 1.0f);
+        log_exit("announceNumber");
+        return;
+    }
+    
+    log_performance("phrase_cache_miss", 1.0f);
+    provideAudioFeedback(message);
+    log_exit("announceNumber");
+}
+
+bool provisionPhraseCache() {
+    log_entry("provisionPhraseCache");
+    
+    size_t count = 0;
+    const PhraseSource* vocabulary = phrase_vocabulary(&count);
+    PhraseCacheBuilder builder;
+    if (!builder.begin(PHRASE_CACHE_PATH, SAMPLE_RATE)) {
+        log_exit("provisionPhraseCache");
+        return false;
+    }
+    
+    // One TTS call per clip, only on first boot
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        std::vector<uint8_t> audio = elevenlabs_text_to_speech(vocabulary[i].text);
+        size_t samples = audio.size() / sizeof(int16_t);
+        int16_t* pcm = reinterpret_cast<int16_t*>(audio.data());
+        samples = phrase_trim_silence(pcm, samples);
+        ok = builder.addClip(vocabulary[i].key, pcm, samples);
+        Serial.printf("🗣️  Rendered '%s' (%u ms)\n", vocabulary[i].text, (unsigned)(samples * 1000 / SAMPLE_RATE));
+    }
+    ok = builder.finish() && ok;
     
-    M5.Display.setCursor(5, 8);
-    M5.Display.print("CLOAKROOM");
+    if (!ok) {
+        // Through the VFS, by the same path the builder wrote
+        remove(PHRASE_CACHE_PATH);
+    }
+    ok = ok && phrase_cache.open();
+    log_exit("provisionPhraseCache");
+    return ok;
+}
+
+void archiveEnrollmentAudio(uint16_t number) {
+    log_entry("archiveEnrollmentAudio");
     
-    M5.Display.setCursor(5, 32);
-    M5.Display.print("VOICE ID");
+    if (last_utterance_audio.empty()) {
+        log_exit("archiveEnrollmentAudio");
+        return;
+    }
     
-    M5.Display.setCursor(5, 60);
-    M5.Display.print(status);
+    std::vector<uint8_t> archived = audio_transcode_wav(last_utterance_audio, ENROLLMENT_ARCHIVE_FORMAT);
     
-    if (extra && strlen(extra) > 0) {
-        M5.Display.setCursor(5, 88);
-        M5.Display.setTextSize(3);
-        M5.Display.print(extra);
+    char path[32];
+    snprintf(path, sizeof(path), ENROLLMENT_ARCHIVE_DIR "/%03u.wav", number);
+    LittleFS.mkdir(ENROLLMENT_ARCHIVE_DIR);
+    File file = LittleFS.open(path, "w");
+    if (file && file.write(archived.data(), archived.size()) == archived.size()) {
+        Serial.printf("💾 Archived enrollment as %s (%u bytes, %s)\n", path, (unsigned)archived.size(),
+                      audio_format_name(ENROLLMENT_ARCHIVE_FORMAT));
+    } else {
+        log_error(0x06, "Enrollment archive write failed");
     }
+    file.close();
+    
+    log_exit("archiveEnrollmentAudio");
+}
+
+void updateDisplay(const char* status, int color, const char* extra) {
+    // Only the lines that changed are pushed to the panel
+    display_show_status(status, (uint16_t)color, extra);
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ * Lock-free Single-Producer/Single-Consumer Ring Buffer
+ * Preallocated storage shared between the I2S reader task and consumers
+ */
+
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// One producer task calls write(), one consumer task calls read().
+// Capacity is rounded up to a power of two so indices wrap with a mask;
+// head and tail run freely and their difference is the fill level.
+template <typename T>
+class SpscRingBuffer {
+private:
+    T* storage;
+    size_t capacity;
+    size_t mask;
+    std::atomic<size_t> head; // next slot the producer writes
+    std::atomic<size_t> tail; // next slot the consumer reads
+
+public:
+    explicit SpscRingBuffer(size_t requested_capacity) : storage(nullptr), capacity(0), mask(0), head(0), tail(0) {
+        size_t rounded = 1;
+        while (rounded < requested_capacity) {
+            rounded <<= 1;
+        }
+        storage = (T*)malloc(rounded * sizeof(T));
+        if (storage) {
+            capacity = rounded;
+            mask = rounded - 1;
+        }
+    }
+
+    ~SpscRingBuffer() {
+        if (storage) {
+            free(storage);
+        }
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    bool isAllocated() const { return storage != nullptr; }
+    size_t size() const { return capacity; }
+
+    size_t available() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t space() const { return capacity - available(); }
+
+    // Producer side: copies up to count items, returns how many fit
+    size_t write(const T* data, size_t count) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_acquire);
+        size_t free_items = capacity - (h - t);
+        if (count > free_items) {
+            count = free_items;
+        }
+
+        const size_t start = h & mask;
+        const size_t first = (count < capacity - start) ? count : capacity - start;
+        memcpy(storage + start, data, first * sizeof(T));
+        memcpy(storage, data + first, (count - first) * sizeof(T));
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side: copies up to count items, returns how many were read
+    size_t read(T* out, size_t count) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t h = head.load(std::memory_order_acquire);
+        size_t used = h - t;
+        if (count > used) {
+            count = used;
+        }
+
+        const size_t start = t & mask;
+        const size_t first = (count < capacity - start) ? count : capacity - start;
+        memcpy(out, storage + start, first * sizeof(T));
+        memcpy(out + first, storage, (count - first) * sizeof(T));
+
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    // Only safe while neither side is running
+    void clear() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // AUDIO_RING_BUFFER_H
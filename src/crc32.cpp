@@ -0,0 +1,28 @@
+// Table-driven CRC-32 for journal and snapshot integrity
+#include "crc32.h"
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+// Built at compile time, lives in flash
+static constexpr Crc32Table crc_table;
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,27 @@
+// Table-driven CRC-8 for I2C frame integrity
+#include "crc8.h"
+
+struct Crc8Table {
+    uint8_t entries[256];
+
+    constexpr Crc8Table() : entries() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint8_t crc = (uint8_t)i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+// Built at compile time, lives in flash
+static constexpr Crc8Table crc_table;
+
+uint8_t crc8_update(uint8_t crc, const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table.entries[crc ^ bytes[i]];
+    }
+    return crc;
+}
@@ -1,27 +1,398 @@
 // TFT and LED control
 #include "display_manager.h"
 #include "error_handler.h"
+#include <cstdio>
+#include <cstring>
+
+#define DISPLAY_GLYPH_COUNT (sizeof(DISPLAY_SPRITE_GLYPHS) - 1)
+#define DISPLAY_BANNER_WIDTH (DISPLAY_BANNER_CHARS * DISPLAY_GLYPH_WIDTH * DISPLAY_BANNER_SIZE)
+#define DISPLAY_BANNER_HEIGHT (DISPLAY_GLYPH_HEIGHT * DISPLAY_BANNER_SIZE)
+#define DISPLAY_STRIP_WIDTH (DISPLAY_NUMBER_CELLS * DISPLAY_CELL_WIDTH)
+
+#define DISPLAY_COLOR_SUCCESS 0x07E0    // green
+#define DISPLAY_COLOR_REJECT 0xF800     // red
+
+// Sprite pixels are RGB565 in the panel's byte order, so DMA sends the
+// buffers as they lie
+static inline uint16_t panel_color(uint16_t color) {
+    return (uint16_t)((color >> 8) | (color << 8));
+}
+
+// Glyph masks never change; the coloured copy is redone only when the
+// number colour does
+struct GlyphAtlas {
+    uint8_t mask[DISPLAY_GLYPH_COUNT][DISPLAY_CELL_HEIGHT][DISPLAY_CELL_WIDTH];
+    uint16_t pixels[DISPLAY_GLYPH_COUNT][DISPLAY_CELL_HEIGHT][DISPLAY_CELL_WIDTH];
+    uint16_t color;
+    bool colored;
+};
+
+struct BannerSprite {
+    const char* text;
+    DisplayWidgetId widget;
+    int16_t width;
+    uint16_t pixels[DISPLAY_BANNER_HEIGHT][DISPLAY_BANNER_WIDTH];
+};
+
+static GlyphAtlas atlas;
+static BannerSprite banners[] = {
+    {"CLOAKROOM", DISPLAY_BANNER, 0, {}},
+    {"VOICE ID", DISPLAY_BANNER_SUB, 0, {}},
+};
+static bool sprites_ready = false;
+
+// Off-screen number line; DMA reads it until the next render waits
+static uint16_t strip[DISPLAY_CELL_HEIGHT][DISPLAY_STRIP_WIDTH];
+
+#ifdef ESP32
+#include <M5Unified.h>
+
+static bool dma_pending = false;
+
+// Draws text once into an off-screen canvas and keeps which pixels it inked
+static bool rasterize(const char* text, uint8_t size, uint8_t* mask, int width, int height) {
+    M5Canvas canvas(&M5.Display);
+    canvas.setColorDepth(8);
+    if (!canvas.createSprite(width, height)) {
+        return false;
+    }
+    canvas.fillSprite(TFT_BLACK);
+    canvas.setTextSize(size);
+    canvas.setTextColor(TFT_WHITE);
+    canvas.drawString(text, 0, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            mask[y * width + x] = canvas.readPixel(x, y) != 0;
+        }
+    }
+    canvas.deleteSprite();
+    return true;
+}
+
+static void panel_flush() {
+    if (dma_pending) {
+        M5.Display.waitDMA();
+        M5.Display.endWrite();
+        dma_pending = false;
+    }
+}
+
+static void panel_begin() {
+    panel_flush();
+    M5.Display.startWrite();
+}
+
+// A DMA push still running keeps the transaction open; panel_flush() ends it
+static void panel_end(bool dma) {
+    if (dma) {
+        dma_pending = true;
+    } else {
+        M5.Display.endWrite();
+    }
+}
+
+static void panel_fill(const DisplayRect& rect) {
+    M5.Display.fillRect(rect.x, rect.y, rect.w, rect.h, DISPLAY_BACKGROUND);
+}
+
+// Foreground and background both set: glyph cells are written opaque
+static void panel_text(const DisplayWidget& widget) {
+    M5.Display.setTextSize(widget.text_size);
+    M5.Display.setTextColor(widget.color, DISPLAY_BACKGROUND);
+    M5.Display.drawString(widget.text, widget.x, widget.y);
+}
+
+static void panel_push(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t* pixels) {
+    M5.Display.pushImageDMA(x, y, width, height, reinterpret_cast<const lgfx::swap565_t*>(pixels));
+}
+#else
+// Host builds keep the model, compositing and accounting without a panel;
+// there is no font to rasterize, so sprites stay blank
+static bool rasterize(const char* text, uint8_t size, uint8_t* mask, int width, int height) {
+    (void)text;
+    (void)size;
+    memset(mask, 0, (size_t)width * height);
+    return true;
+}
+
+static void panel_flush() {}
+static void panel_begin() {}
+static void panel_end(bool dma) { (void)dma; }
+static void panel_fill(const DisplayRect& rect) { (void)rect; }
+static void panel_text(const DisplayWidget& widget) { (void)widget; }
+static void panel_push(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t* pixels) {
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+    (void)pixels;
+}
+#endif
+
+static bool prerender_sprites() {
+    const char* glyphs = DISPLAY_SPRITE_GLYPHS;
+    for (size_t i = 0; i < DISPLAY_GLYPH_COUNT; i++) {
+        char glyph[2] = {glyphs[i], '\0'};
+        if (!rasterize(glyph, DISPLAY_NUMBER_SIZE, &atlas.mask[i][0][0], DISPLAY_CELL_WIDTH, DISPLAY_CELL_HEIGHT)) {
+            return false;
+        }
+    }
+    atlas.colored = false;
+
+    static uint8_t mask[DISPLAY_BANNER_HEIGHT][DISPLAY_BANNER_WIDTH];
+    for (BannerSprite& banner : banners) {
+        banner.width = (int16_t)(strlen(banner.text) * DISPLAY_GLYPH_WIDTH * DISPLAY_BANNER_SIZE);
+        if (!rasterize(banner.text, DISPLAY_BANNER_SIZE, &mask[0][0], banner.width, DISPLAY_BANNER_HEIGHT)) {
+            return false;
+        }
+        // Packed to the sprite's own width so one push sends it
+        const uint8_t* in = &mask[0][0];
+        uint16_t* out = &banner.pixels[0][0];
+        for (int i = 0; i < DISPLAY_BANNER_HEIGHT * banner.width; i++) {
+            out[i] = panel_color(in[i] ? DISPLAY_BANNER_COLOR : DISPLAY_BACKGROUND);
+        }
+    }
+    return true;
+}
+
+static void color_atlas(uint16_t color) {
+    if (atlas.colored && atlas.color == color) {
+        return;
+    }
+    uint16_t ink = panel_color(color);
+    uint16_t paper = panel_color(DISPLAY_BACKGROUND);
+    for (size_t i = 0; i < DISPLAY_GLYPH_COUNT; i++) {
+        for (int y = 0; y < DISPLAY_CELL_HEIGHT; y++) {
+            for (int x = 0; x < DISPLAY_CELL_WIDTH; x++) {
+                atlas.pixels[i][y][x] = atlas.mask[i][y][x] ? ink : paper;
+            }
+        }
+    }
+    atlas.color = color;
+    atlas.colored = true;
+}
+
+// Glyph cell indices for text, or false when it needs the font
+static bool sprite_glyphs(const DisplayWidget& widget, uint8_t* cells, size_t* count) {
+    if (!sprites_ready || widget.text_size != DISPLAY_NUMBER_SIZE) {
+        return false;
+    }
+    size_t length = strlen(widget.text);
+    if (length > DISPLAY_NUMBER_CELLS) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        const char* found = strchr(DISPLAY_SPRITE_GLYPHS, widget.text[i]);
+        if (!found) {
+            return false;
+        }
+        cells[i] = (uint8_t)(found - DISPLAY_SPRITE_GLYPHS);
+    }
+    *count = length;
+    return true;
+}
+
+// Row copies from the atlas into the strip, then one DMA push
+static void push_sprite_text(const DisplayWidget& widget, const uint8_t* cells, size_t count) {
+    color_atlas(widget.color);
+    int16_t width = (int16_t)(count * DISPLAY_CELL_WIDTH);
+    for (int y = 0; y < DISPLAY_CELL_HEIGHT; y++) {
+        // Packed to the text's width so the push is one contiguous block
+        uint16_t* row = &strip[0][0] + y * width;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(row + i * DISPLAY_CELL_WIDTH, atlas.pixels[cells[i]][y], DISPLAY_CELL_WIDTH * sizeof(uint16_t));
+        }
+    }
+    panel_push(widget.x, widget.y, width, DISPLAY_CELL_HEIGHT, &strip[0][0]);
+}
+
+static const BannerSprite* banner_sprite(const DisplayWidget& widget, DisplayWidgetId id) {
+    if (!sprites_ready || widget.text_size != DISPLAY_BANNER_SIZE || widget.color != DISPLAY_BANNER_COLOR) {
+        return nullptr;
+    }
+    for (const BannerSprite& banner : banners) {
+        if (banner.widget == id && strcmp(banner.text, widget.text) == 0) {
+            return &banner;
+        }
+    }
+    return nullptr;
+}
+
+static size_t area(const DisplayRect& rect) {
+    return rect.w > 0 && rect.h > 0 ? (size_t)rect.w * rect.h : 0;
+}
+
+static DisplayRect text_extent(const DisplayWidget& widget) {
+    DisplayRect rect;
+    rect.x = widget.x;
+    rect.y = widget.y;
+    rect.w = (int16_t)(strlen(widget.text) * DISPLAY_GLYPH_WIDTH * widget.text_size);
+    rect.h = (int16_t)(widget.text[0] ? DISPLAY_GLYPH_HEIGHT * widget.text_size : 0);
+    return rect;
+}
+
+DisplayScreen::DisplayScreen() {
+    memset(widgets, 0, sizeof(widgets));
+    for (size_t i = 0; i < DISPLAY_WIDGETS; i++) {
+        widgets[i].text_size = 1;
+    }
+}
+
+void DisplayScreen::place(DisplayWidgetId id, int16_t x, int16_t y, uint8_t text_size) {
+    DisplayWidget& widget = widgets[id];
+    if (widget.x == x && widget.y == y && widget.text_size == text_size) {
+        return;
+    }
+    // The old text stays in drawn until render() erases it
+    widget.x = x;
+    widget.y = y;
+    widget.text_size = text_size;
+    widget.dirty = true;
+}
+
+void DisplayScreen::setText(DisplayWidgetId id, const char* text, uint16_t color) {
+    DisplayWidget& widget = widgets[id];
+    if (!text) {
+        text = "";
+    }
+    if (widget.color == color && strncmp(widget.text, text, DISPLAY_TEXT_MAX - 1) == 0) {
+        return;
+    }
+    strncpy(widget.text, text, DISPLAY_TEXT_MAX - 1);
+    widget.text[DISPLAY_TEXT_MAX - 1] = '\0';
+    widget.color = color;
+    widget.dirty = true;
+}
+
+void DisplayScreen::invalidate() {
+    for (size_t i = 0; i < DISPLAY_WIDGETS; i++) {
+        widgets[i].dirty = true;
+    }
+}
+
+size_t DisplayScreen::render() {
+    size_t pixels = 0;
+    bool writing = false;
+    bool dma = false;
+    for (size_t i = 0; i < DISPLAY_WIDGETS; i++) {
+        DisplayWidget& widget = widgets[i];
+        if (!widget.dirty) {
+            continue;
+        }
+        if (!writing) {
+            // One SPI transaction for the whole pass; it also waits out the
+            // previous pass's DMA before the strip is rewritten
+            panel_begin();
+            writing = true;
+        }
+        DisplayRect old_rect = widget.drawn;
+        DisplayRect new_rect = text_extent(widget);
+
+        if (old_rect.x != new_rect.x || old_rect.y != new_rect.y) {
+            // Moved: the old text goes entirely
+            if (area(old_rect) > 0) {
+                panel_fill(old_rect);
+                pixels += area(old_rect);
+            }
+        } else {
+            // Same origin: erase only what the new text does not cover,
+            // the strip to its right and the band below it
+            DisplayRect right = {(int16_t)(old_rect.x + new_rect.w), old_rect.y,
+                                 (int16_t)(old_rect.w - new_rect.w), old_rect.h};
+            DisplayRect below = {old_rect.x, (int16_t)(old_rect.y + new_rect.h),
+                                 (int16_t)(old_rect.w < new_rect.w ? old_rect.w : new_rect.w),
+                                 (int16_t)(old_rect.h - new_rect.h)};
+            if (area(right) > 0) {
+                panel_fill(right);
+                pixels += area(right);
+            }
+            if (area(below) > 0) {
+                panel_fill(below);
+                pixels += area(below);
+            }
+        }
+        if (widget.text[0]) {
+            // Prerendered sprites where they exist, the font otherwise
+            uint8_t cells[DISPLAY_NUMBER_CELLS];
+            size_t count = 0;
+            const BannerSprite* banner = banner_sprite(widget, (DisplayWidgetId)i);
+            if (banner) {
+                panel_push(widget.x, widget.y, banner->width, DISPLAY_BANNER_HEIGHT, &banner->pixels[0][0]);
+                dma = true;
+            } else if (sprite_glyphs(widget, cells, &count)) {
+                push_sprite_text(widget, cells, count);
+                dma = true;
+            } else {
+                panel_text(widget);
+            }
+            pixels += area(new_rect);
+        }
+        widget.drawn = new_rect;
+        widget.dirty = false;
+    }
+    if (writing) {
+        panel_end(dma);
+    }
+    return pixels;
+}
+
+DisplayScreen& display_screen() {
+    static DisplayScreen screen;
+    return screen;
+}
+
+void display_begin(const DisplayLayout& layout) {
+    log_entry("display_begin");
+    sprites_ready = prerender_sprites();
+    if (!sprites_ready) {
+        log_error(0x08, "Display sprites unavailable");
+    }
+    DisplayScreen& screen = display_screen();
+    screen.place(DISPLAY_BANNER, layout.x, layout.banner_y, DISPLAY_BANNER_SIZE);
+    screen.place(DISPLAY_BANNER_SUB, layout.x, layout.banner_sub_y, DISPLAY_BANNER_SIZE);
+    screen.place(DISPLAY_STATUS, layout.x, layout.status_y, 2);
+    screen.place(DISPLAY_NUMBER, layout.x, layout.number_y, DISPLAY_NUMBER_SIZE);
+    // The banner no longer follows the status colour, so it is drawn once
+    screen.setText(DISPLAY_BANNER, "CLOAKROOM", DISPLAY_BANNER_COLOR);
+    screen.setText(DISPLAY_BANNER_SUB, "VOICE ID", DISPLAY_BANNER_COLOR);
+    screen.render();
+    log_exit("display_begin");
+}
+
+void display_flush() {
+    panel_flush();
+}
+
+void display_show_status(const char* status, uint16_t color, const char* extra) {
+    DisplayScreen& screen = display_screen();
+    screen.setText(DISPLAY_STATUS, status, color);
+    screen.setText(DISPLAY_NUMBER, extra, color);
+    screen.render();
+}
+
+// "#042": four glyph blits rather than a font pass
+static void format_number(uint16_t number, char* text, size_t size) {
+    snprintf(text, size, "#%03u", (unsigned)number);
+}
 
 void show_assignment_number(uint16_t number) {
     log_entry("show_assignment_number");
-    // ...display logic...
+    char text[DISPLAY_NUMBER_CELLS + 1];
+    format_number(number, text, sizeof(text));
+    display_show_status("ASSIGNED", DISPLAY_COLOR_SUCCESS, text);
     log_exit("show_assignment_number");
 }
+
 void show_recognition_success(uint16_t number) {
     log_entry("show_recognition_success");
-    // Display success feedback (e.g., green LED, confirmation message)
-    // tft.print("Recognition successful! Number: ");
-    // tft.print(number);
-    // Set LED matrix to green
-    // ...existing code...
+    char text[DISPLAY_NUMBER_CELLS + 1];
+    format_number(number, text, sizeof(text));
+    display_show_status("FOUND", DISPLAY_COLOR_SUCCESS, text);
     log_exit("show_recognition_success");
 }
 
 void show_rejection_feedback() {
     log_entry("show_rejection_feedback");
-    // Display rejection feedback (e.g., red LED, error message)
-    // tft.print("Recognition failed. Please try again.");
-    // Set LED matrix to red
-    // ...existing code...
+    display_show_status("NOT FOUND", DISPLAY_COLOR_REJECT, "");
     log_exit("show_rejection_feedback");
 }
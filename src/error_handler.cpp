@@ -27,7 +27,7 @@ void log_performance(const char* metric, float value) {
 
 
 // Network retry logic
-bool retry_network_operation(std::function<bool()> operation, int max_retries = 3) {
+bool retry_network_operation(std::function<bool()> operation, int max_retries) {
     log_entry("retry_network_operation");
     
     for (int attempt = 1; attempt <= max_retries; attempt++) {
@@ -0,0 +1,141 @@
+// Timing wheel for profile expiry
+#include "expiry_wheel.h"
+
+ExpiryWheel::ExpiryWheel(size_t max_slots)
+    : current_tick(0), scheduled(0), next(max_slots, -1), prev(max_slots, -1),
+      bucket_of(max_slots, EXPIRY_UNSCHEDULED), deadline_tick(max_slots, 0) {
+    for (size_t i = 0; i < 2 * EXPIRY_WHEEL_SIZE; i++) {
+        heads[i] = -1;
+    }
+}
+
+void ExpiryWheel::start(uint32_t now_seconds) {
+    current_tick = now_seconds / EXPIRY_TICK_SECONDS;
+}
+
+void ExpiryWheel::clear() {
+    for (size_t i = 0; i < 2 * EXPIRY_WHEEL_SIZE; i++) {
+        heads[i] = -1;
+    }
+    for (size_t slot = 0; slot < bucket_of.size(); slot++) {
+        next[slot] = prev[slot] = -1;
+        bucket_of[slot] = EXPIRY_UNSCHEDULED;
+    }
+    scheduled = 0;
+}
+
+void ExpiryWheel::link(int16_t slot, uint8_t bucket) {
+    next[slot] = heads[bucket];
+    prev[slot] = -1;
+    if (heads[bucket] >= 0) {
+        prev[heads[bucket]] = slot;
+    }
+    heads[bucket] = slot;
+    bucket_of[slot] = bucket;
+}
+
+void ExpiryWheel::unlink(int16_t slot) {
+    uint8_t bucket = bucket_of[slot];
+    if (prev[slot] >= 0) {
+        next[prev[slot]] = next[slot];
+    } else {
+        heads[bucket] = next[slot];
+    }
+    if (next[slot] >= 0) {
+        prev[next[slot]] = prev[slot];
+    }
+    next[slot] = prev[slot] = -1;
+    bucket_of[slot] = EXPIRY_UNSCHEDULED;
+}
+
+void ExpiryWheel::place(int16_t slot) {
+    uint32_t deadline = deadline_tick[slot];
+    // Already due: the next tick picks it up
+    if ((int32_t)(deadline - current_tick) <= 0) {
+        deadline = current_tick + 1;
+    }
+    uint32_t delta = deadline - current_tick;
+
+    if (delta < EXPIRY_WHEEL_SIZE) {
+        link(slot, (uint8_t)(deadline & EXPIRY_WHEEL_MASK));
+        return;
+    }
+    // Past the level 1 span: park in the farthest bucket and re-place on cascade
+    if (delta >= EXPIRY_WHEEL_SIZE * EXPIRY_WHEEL_SIZE) {
+        deadline = current_tick + EXPIRY_WHEEL_SIZE * EXPIRY_WHEEL_SIZE - 1;
+    }
+    link(slot, (uint8_t)(EXPIRY_WHEEL_SIZE + ((deadline >> EXPIRY_WHEEL_BITS) & EXPIRY_WHEEL_MASK)));
+}
+
+void ExpiryWheel::schedule(int16_t slot, uint32_t deadline_seconds) {
+    if (slot < 0 || (size_t)slot >= bucket_of.size()) {
+        return;
+    }
+    if (isScheduled(slot)) {
+        unlink(slot);
+    } else {
+        scheduled++;
+    }
+    deadline_tick[slot] = deadline_seconds / EXPIRY_TICK_SECONDS;
+    place(slot);
+}
+
+void ExpiryWheel::cancel(int16_t slot) {
+    if (slot < 0 || (size_t)slot >= bucket_of.size() || !isScheduled(slot)) {
+        return;
+    }
+    unlink(slot);
+    scheduled--;
+}
+
+size_t ExpiryWheel::advance(uint32_t now_seconds, const ExpiryCallback& expire) {
+    uint32_t target = now_seconds / EXPIRY_TICK_SECONDS;
+    size_t expired = 0;
+
+    while ((int32_t)(target - current_tick) > 0) {
+        current_tick++;
+
+        // Start of a level 1 bucket: spread it over level 0
+        if ((current_tick & EXPIRY_WHEEL_MASK) == 0) {
+            uint8_t bucket = EXPIRY_WHEEL_SIZE + ((current_tick >> EXPIRY_WHEEL_BITS) & EXPIRY_WHEEL_MASK);
+            int16_t slot = heads[bucket];
+            heads[bucket] = -1;
+            while (slot >= 0) {
+                int16_t following = next[slot];
+                bucket_of[slot] = EXPIRY_UNSCHEDULED;
+                place(slot);
+                slot = following;
+            }
+        }
+
+        uint8_t bucket = current_tick & EXPIRY_WHEEL_MASK;
+        int16_t slot = heads[bucket];
+        while (slot >= 0) {
+            int16_t following = next[slot];
+            unlink(slot);
+            if ((int32_t)(deadline_tick[slot] - current_tick) <= 0) {
+                scheduled--;
+                expired++;
+                expire(slot);
+            } else {
+                place(slot);
+            }
+            slot = following;
+        }
+    }
+    return expired;
+}
+
+size_t ExpiryWheel::expireAll(const ExpiryCallback& expire) {
+    size_t expired = 0;
+    for (size_t bucket = 0; bucket < 2 * EXPIRY_WHEEL_SIZE; bucket++) {
+        while (heads[bucket] >= 0) {
+            int16_t slot = heads[bucket];
+            unlink(slot);
+            scheduled--;
+            expired++;
+            expire(slot);
+        }
+    }
+    return expired;
+}
@@ -1,41 +1,593 @@
 // Device communication via I2C
 #include "i2c_communication.h"
+#include "crc8.h"
 #include "error_handler.h"
+#include "audio_ring_buffer.h"
+#include <cstring>
+#include <mutex>
 
-void send_i2c_message() {
-    log_entry("send_i2c_message");
-    // ...I2C logic...
-    log_exit("send_i2c_message");
+#ifdef ESP32
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include "virtual_i2c_bus.h"
+#endif
+
+// One encoded frame, as queued for the wire
+struct I2CFrame {
+    uint8_t size;
+    uint8_t bytes[I2C_FRAME_MAX];
+};
+
+size_t i2c_fragment_count(const I2CMessage& msg) {
+    size_t length = msg.length > I2C_BUFFER_SIZE ? I2C_BUFFER_SIZE : msg.length;
+    // An empty message still takes one frame
+    return length == 0 ? 1 : (length + I2C_FRAME_PAYLOAD - 1) / I2C_FRAME_PAYLOAD;
+}
+
+size_t i2c_encode_frame(const I2CMessage& msg, size_t index, uint8_t* frame) {
+    size_t fragments = i2c_fragment_count(msg);
+    if (index >= fragments) {
+        return 0;
+    }
+    size_t length = msg.length > I2C_BUFFER_SIZE ? I2C_BUFFER_SIZE : msg.length;
+    size_t offset = index * I2C_FRAME_PAYLOAD;
+    size_t chunk = length - offset < I2C_FRAME_PAYLOAD ? length - offset : I2C_FRAME_PAYLOAD;
+
+    frame[0] = (uint8_t)chunk;
+    frame[1] = msg.command;
+    frame[2] = (uint8_t)index | (index + 1 < fragments ? I2C_FRAGMENT_MORE : 0);
+    frame[3] = msg.sequence;
+    memcpy(frame + I2C_FRAME_HEADER_SIZE, msg.data + offset, chunk);
+    frame[I2C_FRAME_HEADER_SIZE + chunk] = crc8_update(0, frame, I2C_FRAME_HEADER_SIZE + chunk);
+    return chunk + I2C_FRAME_OVERHEAD;
+}
+
+size_t i2c_frame_size(const uint8_t* frame, size_t available) {
+    if (available < I2C_FRAME_OVERHEAD || frame[0] > I2C_FRAME_PAYLOAD) {
+        return 0;
+    }
+    size_t size = frame[0] + I2C_FRAME_OVERHEAD;
+    return size <= available ? size : 0;
+}
+
+bool i2c_frame_valid(const uint8_t* frame, size_t available) {
+    size_t size = i2c_frame_size(frame, available);
+    return size > 0 && crc8_update(0, frame, size - 1) == frame[size - 1];
 }
 
-#include <cstdint>
-#define I2C_BUFFER_SIZE 64
+I2CReassembler::I2CReassembler() {
+    reset();
+}
+
+void I2CReassembler::reset() {
+    partial.command = I2C_COMMAND_NONE;
+    partial.sequence = 0;
+    partial.length = 0;
+    next_index = 0;
+    active = false;
+}
+
+bool I2CReassembler::feed(const uint8_t* frame, size_t available, I2CMessage& msg) {
+    if (!i2c_frame_valid(frame, available)) {
+        log_error(0x07, "I2C frame CRC");
+        reset();
+        return false;
+    }
+    uint8_t length = frame[0];
+    uint8_t command = frame[1];
+    uint8_t index = frame[2] & I2C_FRAGMENT_INDEX_MASK;
+    bool more = (frame[2] & I2C_FRAGMENT_MORE) != 0;
+
+    if (index == 0) {
+        reset();
+        partial.command = command;
+        active = true;
+    } else if (!active || index != next_index || command != partial.command) {
+        // A fragment went missing; wait for the next message to start
+        log_error(0x07, "I2C fragment out of order");
+        reset();
+        return false;
+    }
+    if (partial.length + length > I2C_BUFFER_SIZE || (more && index + 1 >= I2C_MAX_FRAGMENTS)) {
+        log_error(0x07, "I2C message too long");
+        reset();
+        return false;
+    }
+
+    memcpy(partial.data + partial.length, frame + I2C_FRAME_HEADER_SIZE, length);
+    partial.length += length;
+    partial.sequence = frame[3];
+    next_index = index + 1;
+    if (more) {
+        return false;
+    }
+    msg = partial;
+    reset();
+    return true;
+}
 
-struct I2CMessage {
-    uint8_t command;
-    uint8_t data[I2C_BUFFER_SIZE];
-    uint8_t checksum;
+static bool peripheral_mode = false;
+
+// ---- Peripheral side: runs in the Wire callbacks ----
+
+// Messages written to us as a peripheral, waiting for receive_message()
+static SpscRingBuffer<I2CMessage> inbox(I2C_INBOX_MESSAGES);
+static I2CReassembler peripheral_reassembler;
+// Last sequence accepted in order; every reply frame acknowledges it
+static uint8_t received_sequence = 0;
+
+// Frames of the reply served on the controller's next reads. A newer reply
+// replaces an unsent one.
+static I2CFrame response[I2C_MAX_FRAGMENTS];
+static uint8_t response_count = 0;
+static uint8_t response_cursor = 0;
+// The controller reads a frame's header first and the rest only when it has
+// a payload; set once that header read has been served
+static bool response_header_sent = false;
+
+#ifdef ESP32
+static portMUX_TYPE response_lock = portMUX_INITIALIZER_UNLOCKED;
+#define RESPONSE_LOCK() portENTER_CRITICAL(&response_lock)
+#define RESPONSE_UNLOCK() portEXIT_CRITICAL(&response_lock)
+#else
+#define RESPONSE_LOCK()
+#define RESPONSE_UNLOCK()
+#endif
+
+static void peripheral_frame_written(const uint8_t* frame, size_t size) {
+    // Writes arrive whole, so a corrupted length byte shows up here
+    if (i2c_frame_size(frame, size) != size) {
+        log_error(0x07, "I2C frame length");
+        peripheral_reassembler.reset();
+        return;
+    }
+    I2CMessage msg;
+    if (!peripheral_reassembler.feed(frame, size, msg)) {
+        return;
+    }
+    // Duplicates and messages after a gap are dropped; the ACK in our next
+    // reply tells the controller where to resume
+    if (msg.sequence != (uint8_t)(received_sequence + 1)) {
+        return;
+    }
+    // Not acknowledged either, so the controller sends it again later
+    if (inbox.write(&msg, 1) == 0) {
+        log_error(0x07, "I2C inbox full");
+        return;
+    }
+    received_sequence = msg.sequence;
+}
+
+// A frame with a payload is served twice: its header, then in full on the
+// read that follows. Only the full-length read moves on to the next frame.
+static size_t peripheral_frame_requested(uint8_t* frame) {
+    I2CFrame reply;
+    bool ready = false;
+    bool header = false;
+    RESPONSE_LOCK();
+    if (response_cursor < response_count) {
+        reply = response[response_cursor];
+        ready = true;
+        header = reply.size > I2C_FRAME_OVERHEAD && !response_header_sent;
+        if (header) {
+            response_header_sent = true;
+        } else {
+            response_cursor++;
+            response_header_sent = false;
+        }
+    }
+    RESPONSE_UNLOCK();
+    if (!ready) {
+        // Empty NONE frame, there only to carry the ACK
+        memset(reply.bytes, 0, I2C_FRAME_OVERHEAD);
+        reply.size = I2C_FRAME_OVERHEAD;
+    }
+    reply.bytes[3] = received_sequence;
+    reply.bytes[reply.size - 1] = crc8_update(0, reply.bytes, reply.size - 1);
+    size_t size = header ? I2C_FRAME_OVERHEAD : reply.size;
+    memcpy(frame, reply.bytes, size);
+    return size;
+}
+
+static void stage_response(const I2CMessage& msg) {
+    I2CFrame frames[I2C_MAX_FRAGMENTS];
+    size_t count = i2c_fragment_count(msg);
+    for (size_t i = 0; i < count; i++) {
+        frames[i].size = (uint8_t)i2c_encode_frame(msg, i, frames[i].bytes);
+    }
+    RESPONSE_LOCK();
+    memcpy(response, frames, count * sizeof(I2CFrame));
+    response_count = (uint8_t)count;
+    response_cursor = 0;
+    response_header_sent = false;
+    RESPONSE_UNLOCK();
+}
+
+#ifdef ESP32
+static void on_receive(int length) {
+    uint8_t frame[I2C_FRAME_MAX];
+    size_t received = 0;
+    while (Wire.available()) {
+        int value = Wire.read();
+        if (received < sizeof(frame)) {
+            frame[received++] = (uint8_t)value;
+        }
+    }
+    if (length > I2C_FRAME_MAX) {
+        log_error(0x07, "I2C frame length");
+        peripheral_reassembler.reset();
+        return;
+    }
+    peripheral_frame_written(frame, received);
+}
+
+static void on_request() {
+    uint8_t frame[I2C_FRAME_MAX];
+    size_t size = peripheral_frame_requested(frame);
+    Wire.write(frame, size);
+}
+#endif
+
+// ---- Controller side: the bus task owns the wire ----
+
+// Queued sends. Indices only grow: head is the oldest unacknowledged
+// message, resend the next one to transmit again after a timeout, next
+// the first never transmitted, tail the next free entry.
+struct PendingSend {
+    I2CMessage msg;
+    I2CSendCallback done;
+    uint8_t attempts;
 };
 
-// Calculate checksum
-uint8_t calc_checksum(const I2CMessage& msg) {
-    uint8_t sum = msg.command;
-    for (int i = 0; i < I2C_BUFFER_SIZE; ++i) sum += msg.data[i];
-    return sum;
+static PendingSend pending[I2C_SEND_QUEUE];
+static uint32_t send_head = 0;
+static uint32_t send_resend = 0;
+static uint32_t send_next = 0;
+static uint32_t send_tail = 0;
+static std::mutex send_lock;
+
+static uint8_t next_sequence = 1;
+static bool synced = false;         // next_sequence agrees with the peripheral
+static uint32_t last_send_ms = 0;
+static uint32_t last_poll_ms = 0;
+static uint32_t last_progress_ms = 0;
+
+// Replies read back from the peripheral, waiting for receive_message()
+static SpscRingBuffer<I2CMessage> controller_inbox(I2C_INBOX_MESSAGES);
+static I2CReassembler controller_reassembler;
+
+#ifdef ESP32
+#define I2C_TASK_STACK 4096
+#define I2C_TASK_PRIORITY 1
+#define I2C_TASK_CORE 0
+
+static TaskHandle_t bus_task = nullptr;
+
+static void i2c_task(void* arg) {
+    while (true) {
+        i2c_service(millis());
+        // A new send wakes us early; otherwise poll on the period
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2C_SERVICE_PERIOD_MS));
+    }
 }
 
-// Send message
-bool send_message(const I2CMessage& msg) {
+static bool bus_write(const uint8_t* frame, size_t size) {
+    Wire.beginTransmission(I2C_FEATHER_ADDRESS);
+    Wire.write(frame, size);
+    return Wire.endTransmission() == 0;
+}
+
+static size_t bus_read(uint8_t* frame, size_t size) {
+    size_t received = Wire.requestFrom((uint8_t)I2C_FEATHER_ADDRESS, (uint8_t)size);
+    size_t used = 0;
+    while (Wire.available()) {
+        int value = Wire.read();
+        if (used < size) {
+            frame[used++] = (uint8_t)value;
+        }
+    }
+    return received == 0 ? 0 : used;
+}
+#else
+// Host loopback: the controller's bus calls land straight in the
+// peripheral handlers, or pass through a simulated bus when one is attached
+static I2CRole role = I2C_ROLE_CONTROLLER;
+static VirtualI2CBus* virtual_bus = nullptr;
+
+void i2c_set_role(I2CRole value) {
+    role = value;
+    peripheral_mode = value == I2C_ROLE_PERIPHERAL;
+}
+
+void i2c_attach_virtual_bus(VirtualI2CBus* bus) {
+    virtual_bus = bus;
+    if (bus) {
+        VirtualI2CPeripheral feather = {peripheral_frame_written, peripheral_frame_requested};
+        bus->attach(feather);
+    }
+}
+
+static bool bus_write(const uint8_t* frame, size_t size) {
+    if (virtual_bus) {
+        return virtual_bus->write(frame, size);
+    }
+    peripheral_frame_written(frame, size);
+    return true;
+}
+
+static size_t bus_read(uint8_t* frame, size_t size) {
+    if (virtual_bus) {
+        return virtual_bus->read(frame, size);
+    }
+    uint8_t reply[I2C_FRAME_MAX];
+    size_t used = peripheral_frame_requested(reply);
+    used = used < size ? used : size;
+    memcpy(frame, reply, used);
+    return used;
+}
+#endif
+
+// Completes every message the peripheral's ACK covers
+static void acknowledge_through(uint8_t ack, uint32_t now_ms) {
+    I2CSendCallback done[I2C_ACK_WINDOW];
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> guard(send_lock);
+        // A sane ACK lies between the sequence before the oldest message in
+        // flight and the newest one sent
+        uint32_t in_flight = send_next - send_head;
+        uint8_t covered = (uint8_t)(ack - (uint8_t)(next_sequence - 1 - in_flight));
+        if (!synced || covered > in_flight) {
+            // First word from the peripheral, or it rebooted: carry on from
+            // its sequence and resend whatever it has not acknowledged
+            next_sequence = ack + 1;
+            send_next = send_resend = send_head;
+            synced = true;
+            last_progress_ms = now_ms;
+            return;
+        }
+        for (; covered > 0; covered--) {
+            PendingSend& entry = pending[send_head % I2C_SEND_QUEUE];
+            done[count++] = std::move(entry.done);
+            entry.done = nullptr;
+            send_head++;
+            last_progress_ms = now_ms;
+        }
+        if (send_resend < send_head) {
+            send_resend = send_head;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (done[i]) {
+            done[i](true);
+        }
+    }
+}
+
+// The controller cannot know a frame's length up front, so it reads the
+// header first: a bare ACK is exactly that long, and only a frame with a
+// payload costs a second, full-length read
+static size_t read_frame(uint8_t* frame) {
+    size_t used = bus_read(frame, I2C_FRAME_OVERHEAD);
+    if (used == I2C_FRAME_OVERHEAD && frame[0] > 0 && frame[0] <= I2C_FRAME_PAYLOAD) {
+        used = bus_read(frame, frame[0] + I2C_FRAME_OVERHEAD);
+    }
+    return used;
+}
+
+// Reads frames until a whole reply or an empty frame comes back
+static void poll_peripheral(uint32_t now_ms) {
+    last_poll_ms = now_ms;
+    uint8_t frame[I2C_FRAME_MAX];
+    for (size_t i = 0; i < I2C_MAX_FRAGMENTS; i++) {
+        size_t used = read_frame(frame);
+        if (!i2c_frame_valid(frame, used)) {
+            if (used > 0) {
+                log_error(0x07, "I2C frame CRC");
+            }
+            controller_reassembler.reset();
+            return;
+        }
+        acknowledge_through(frame[3], now_ms);
+        if (frame[1] == I2C_COMMAND_NONE) {
+            return;
+        }
+        I2CMessage msg;
+        if (controller_reassembler.feed(frame, used, msg)) {
+            if (controller_inbox.write(&msg, 1) == 0) {
+                log_error(0x07, "I2C reply dropped");
+            }
+            return;
+        }
+        if ((frame[2] & I2C_FRAGMENT_MORE) == 0) {
+            return;
+        }
+    }
+}
+
+// Transmits resends first, then new messages while the window has room
+static void transmit_window(uint32_t now_ms) {
+    while (true) {
+        I2CMessage msg;
+        bool resend;
+        {
+            std::lock_guard<std::mutex> guard(send_lock);
+            resend = send_resend < send_next;
+            if (!resend && (send_next == send_tail || send_next - send_head >= I2C_ACK_WINDOW)) {
+                return;
+            }
+            PendingSend& entry = pending[(resend ? send_resend : send_next) % I2C_SEND_QUEUE];
+            if (!resend) {
+                entry.msg.sequence = next_sequence;
+            }
+            msg = entry.msg;
+        }
+
+        size_t count = i2c_fragment_count(msg);
+        uint8_t frame[I2C_FRAME_MAX];
+        for (size_t i = 0; i < count; i++) {
+            size_t size = i2c_encode_frame(msg, i, frame);
+            if (!bus_write(frame, size)) {
+                // NACK: the timeout sends it again
+                log_error(0x07, "I2C send failed");
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(send_lock);
+        if (resend) {
+            send_resend++;
+        } else {
+            if (send_head == send_next) {
+                last_progress_ms = now_ms;
+            }
+            send_next++;
+            send_resend = send_next;
+            next_sequence++;
+        }
+        last_send_ms = now_ms;
+    }
+}
+
+// Goes back to the oldest unacknowledged message; gives up on it after
+// I2C_SEND_ATTEMPTS and resynchronizes with the peripheral
+static void check_timeout(uint32_t now_ms) {
+    I2CSendCallback failed;
+    {
+        std::lock_guard<std::mutex> guard(send_lock);
+        if (send_head == send_tail || now_ms - last_progress_ms < I2C_ACK_TIMEOUT_MS) {
+            return;
+        }
+        last_progress_ms = now_ms;
+        PendingSend& entry = pending[send_head % I2C_SEND_QUEUE];
+        if (++entry.attempts < I2C_SEND_ATTEMPTS) {
+            send_resend = send_head;
+            return;
+        }
+        failed = std::move(entry.done);
+        entry.done = nullptr;
+        send_head++;
+        send_next = send_resend = send_head;
+        synced = false;
+    }
+    log_error(0x07, "I2C message undelivered");
+    if (failed) {
+        failed(false);
+    }
+}
+
+void i2c_service(uint32_t now_ms) {
+    if (peripheral_mode) {
+        return;
+    }
+    if (synced) {
+        transmit_window(now_ms);
+    }
+    // Poll soon while messages wait on an ACK or on the first contact,
+    // otherwise only now and then for replies
+    bool urgent;
+    {
+        std::lock_guard<std::mutex> guard(send_lock);
+        urgent = send_head != send_next || (!synced && send_head != send_tail);
+    }
+    if (urgent ? now_ms - last_poll_ms >= I2C_ACK_POLL_MS && now_ms - last_send_ms >= I2C_ACK_POLL_MS
+               : now_ms - last_poll_ms >= I2C_IDLE_POLL_MS) {
+        poll_peripheral(now_ms);
+    }
+    check_timeout(now_ms);
+}
+
+bool i2c_begin_controller() {
+    log_entry("i2c_begin_controller");
+    peripheral_mode = false;
+    {
+        std::lock_guard<std::mutex> guard(send_lock);
+        send_head = send_resend = send_next = send_tail = 0;
+        synced = false;
+    }
+#ifdef ESP32
+    bool ok = Wire.begin() && Wire.setClock(I2C_BUS_FREQUENCY);
+    if (ok && !bus_task) {
+        // Bus traffic stays off the guest-facing loop
+        ok = xTaskCreatePinnedToCore(i2c_task, "i2c", I2C_TASK_STACK, nullptr,
+                                     I2C_TASK_PRIORITY, &bus_task, I2C_TASK_CORE) == pdPASS;
+    }
+#else
+    bool ok = true;
+#endif
+    log_exit("i2c_begin_controller");
+    return ok;
+}
+
+bool i2c_begin_peripheral(uint8_t address) {
+    log_entry("i2c_begin_peripheral");
+    peripheral_mode = true;
+#ifdef ESP32
+    Wire.onReceive(on_receive);
+    Wire.onRequest(on_request);
+    bool ok = Wire.begin(address);
+#else
+    (void)address;
+    bool ok = true;
+#endif
+    log_exit("i2c_begin_peripheral");
+    return ok;
+}
+
+void send_i2c_message() {
+    log_entry("send_i2c_message");
+    // ...I2C logic...
+    log_exit("send_i2c_message");
+}
+
+// Queue message; the bus task splits it into frames and sends it
+bool send_message(const I2CMessage& msg, I2CSendCallback done) {
     log_entry("send_message");
-    // ...send via I2C bus...
+    if (peripheral_mode) {
+        stage_response(msg);
+        if (done) {
+            done(true);
+        }
+        log_exit("send_message");
+        return true;
+    }
+
+    bool ok;
+    {
+        std::lock_guard<std::mutex> guard(send_lock);
+        ok = send_tail - send_head < I2C_SEND_QUEUE;
+        if (ok) {
+            PendingSend& entry = pending[send_tail % I2C_SEND_QUEUE];
+            entry.msg = msg;
+            entry.done = std::move(done);
+            entry.attempts = 0;
+            send_tail++;
+        }
+    }
+    if (!ok) {
+        log_error(0x07, "I2C send queue full");
+    }
+#ifdef ESP32
+    else if (bus_task) {
+        xTaskNotifyGive(bus_task);
+    }
+#endif
     log_exit("send_message");
-    return true;
+    return ok;
 }
 
-// Receive message
+// Receive message; false when nothing is waiting
 bool receive_message(I2CMessage& msg) {
     log_entry("receive_message");
-    // ...receive from I2C bus...
+    bool ok = (peripheral_mode ? inbox : controller_inbox).read(&msg, 1) == 1;
     log_exit("receive_message");
-    return true;
+    return ok;
+}
+
+size_t i2c_pending_sends() {
+    std::lock_guard<std::mutex> guard(send_lock);
+    return send_tail - send_head;
 }
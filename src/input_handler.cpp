@@ -1,6 +1,7 @@
 // Gamepad and potentiometer input
 #include "input_handler.h"
 #include "error_handler.h"
+#include "voice_matcher.h"
 
 void handle_gamepad_input() {
     log_entry("handle_gamepad_input");
@@ -34,8 +35,12 @@ void adjust_volume(int value) {
 
 void adjust_sensitivity(int value) {
     log_entry("adjust_sensitivity");
-    // value: potentiometer reading for sensitivity
-    // ...sensitivity adjustment logic...
+    // value: potentiometer reading for sensitivity (12-bit ADC)
+    // Maps the knob onto the 70-95% match threshold range
+    if (value < 0) value = 0;
+    if (value > 4095) value = 4095;
+    float threshold = MATCH_THRESHOLD_MIN + (MATCH_THRESHOLD_MAX - MATCH_THRESHOLD_MIN) * (float)value / 4095.0f;
+    set_match_threshold(threshold);
     log_exit("adjust_sensitivity");
 }
 
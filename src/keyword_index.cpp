@@ -0,0 +1,231 @@
+// Hashed keyword index for the voice profile store
+#include "keyword_index.h"
+#include "error_handler.h"
+#include <cstdlib>
+#include <cstring>
+
+size_t keyword_normalize(const char* keyword, char* out, size_t out_size) {
+    size_t length = 0;
+    bool pending_space = false;
+
+    for (const char* p = keyword; *p && length + 1 < out_size; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') {
+            c = c - 'A' + 'a';
+        }
+        bool word_char = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+        if (!word_char) {
+            // Separators and punctuation collapse into a single space
+            pending_space = length > 0;
+            continue;
+        }
+        if (pending_space) {
+            if (length + 2 >= out_size) {
+                break;
+            }
+            out[length++] = ' ';
+            pending_space = false;
+        }
+        out[length++] = c;
+    }
+
+    if (out_size > 0) {
+        out[length] = '\0';
+    }
+    return length;
+}
+
+bool keyword_equal(const char* a, const char* b) {
+    char normalized_a[KEYWORD_MAX_LENGTH];
+    char normalized_b[KEYWORD_MAX_LENGTH];
+    keyword_normalize(a, normalized_a, sizeof(normalized_a));
+    keyword_normalize(b, normalized_b, sizeof(normalized_b));
+    return strcmp(normalized_a, normalized_b) == 0;
+}
+
+uint32_t keyword_hash(const char* keyword) {
+    char normalized[KEYWORD_MAX_LENGTH];
+    keyword_normalize(keyword, normalized, sizeof(normalized));
+
+    uint32_t hash = 2166136261u;
+    for (const char* p = normalized; *p; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// FNV-1a is weak in its low bits, so fold the high half in before masking
+static inline size_t home_position(uint32_t hash, size_t capacity) {
+    return (hash ^ (hash >> 16)) & (capacity - 1);
+}
+
+KeywordIndex::KeywordIndex(size_t initial_capacity) : drain_position(0) {
+    size_t capacity = 1;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+    draining = {nullptr, 0, 0, 0};
+    if (!allocate(active, capacity)) {
+        active = {nullptr, 0, 0, 0};
+    }
+}
+
+KeywordIndex::~KeywordIndex() {
+    release(active);
+    release(draining);
+}
+
+bool KeywordIndex::allocate(Table& table, size_t capacity) {
+    KeywordIndexEntry* entries = (KeywordIndexEntry*)malloc(capacity * sizeof(KeywordIndexEntry));
+    if (!entries) {
+        return false;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].hash = 0;
+        entries[i].slot = KEYWORD_INDEX_EMPTY;
+    }
+    table = {entries, capacity, 0, 0};
+    return true;
+}
+
+void KeywordIndex::release(Table& table) {
+    if (table.entries) {
+        free(table.entries);
+    }
+    table = {nullptr, 0, 0, 0};
+}
+
+void KeywordIndex::place(Table& table, uint32_t hash, int16_t slot) {
+    size_t mask = table.capacity - 1;
+    size_t position = home_position(hash, table.capacity);
+
+    // Reuse the first tombstone or empty position on the probe path
+    while (table.entries[position].slot >= 0) {
+        position = (position + 1) & mask;
+    }
+    if (table.entries[position].slot == KEYWORD_INDEX_EMPTY) {
+        table.used++;
+    }
+    table.entries[position].hash = hash;
+    table.entries[position].slot = slot;
+    table.live++;
+}
+
+bool KeywordIndex::erase(Table& table, uint32_t hash, int16_t slot) {
+    if (!table.entries) {
+        return false;
+    }
+
+    size_t mask = table.capacity - 1;
+    size_t position = home_position(hash, table.capacity);
+    for (size_t probes = 0; probes < table.capacity; probes++) {
+        KeywordIndexEntry& entry = table.entries[position];
+        if (entry.slot == KEYWORD_INDEX_EMPTY) {
+            return false;
+        }
+        if (entry.slot == slot && entry.hash == hash) {
+            // Tombstone keeps later entries of the probe chain reachable
+            entry.slot = KEYWORD_INDEX_TOMBSTONE;
+            table.live--;
+            return true;
+        }
+        position = (position + 1) & mask;
+    }
+    return false;
+}
+
+size_t KeywordIndex::collect(const Table& table, uint32_t hash, int16_t* slots, size_t max_slots) {
+    if (!table.entries) {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t mask = table.capacity - 1;
+    size_t position = home_position(hash, table.capacity);
+    for (size_t probes = 0; probes < table.capacity && count < max_slots; probes++) {
+        const KeywordIndexEntry& entry = table.entries[position];
+        if (entry.slot == KEYWORD_INDEX_EMPTY) {
+            break;
+        }
+        if (entry.slot >= 0 && entry.hash == hash) {
+            slots[count++] = entry.slot;
+        }
+        position = (position + 1) & mask;
+    }
+    return count;
+}
+
+bool KeywordIndex::startRehash() {
+    // Mostly tombstones: rebuild at the same size; otherwise double
+    size_t capacity = active.capacity;
+    if (active.live * 100 >= capacity * KEYWORD_INDEX_MAX_LOAD_PERCENT / 2) {
+        capacity <<= 1;
+    }
+
+    Table fresh;
+    if (!allocate(fresh, capacity)) {
+        log_error(0x03, "Keyword index rehash allocation failed");
+        return false;
+    }
+    draining = active;
+    active = fresh;
+    drain_position = 0;
+    return true;
+}
+
+void KeywordIndex::rehashStep(size_t positions) {
+    while (draining.entries && positions-- > 0) {
+        KeywordIndexEntry& entry = draining.entries[drain_position];
+        if (entry.slot >= 0) {
+            place(active, entry.hash, entry.slot);
+            entry.slot = KEYWORD_INDEX_TOMBSTONE;
+            draining.live--;
+        }
+        if (++drain_position == draining.capacity) {
+            release(draining);
+        }
+    }
+}
+
+bool KeywordIndex::insert(uint32_t hash, int16_t slot) {
+    if (!active.entries || slot < 0) {
+        return false;
+    }
+
+    rehashStep(KEYWORD_INDEX_REHASH_STEP);
+
+    if ((active.used + 1) * 100 > active.capacity * KEYWORD_INDEX_MAX_LOAD_PERCENT) {
+        // A rehash still in flight has to land before the next one starts
+        rehashStep(draining.capacity);
+        if (!startRehash()) {
+            if (active.used + 1 >= active.capacity) {
+                return false;
+            }
+        } else {
+            rehashStep(KEYWORD_INDEX_REHASH_STEP);
+        }
+    }
+
+    place(active, hash, slot);
+    return true;
+}
+
+bool KeywordIndex::remove(uint32_t hash, int16_t slot) {
+    rehashStep(KEYWORD_INDEX_REHASH_STEP);
+    return erase(active, hash, slot) || erase(draining, hash, slot);
+}
+
+size_t KeywordIndex::find(uint32_t hash, int16_t* slots, size_t max_slots) const {
+    size_t count = collect(active, hash, slots, max_slots);
+    return count + collect(draining, hash, slots + count, max_slots - count);
+}
+
+void KeywordIndex::clear() {
+    release(draining);
+    for (size_t i = 0; i < active.capacity; i++) {
+        active.entries[i].slot = KEYWORD_INDEX_EMPTY;
+    }
+    active.used = 0;
+    active.live = 0;
+}
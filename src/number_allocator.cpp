@@ -0,0 +1,170 @@
+// Bitmap allocator for cloakroom assignment numbers
+#include "number_allocator.h"
+#include "error_handler.h"
+
+// Bits a..b of a word, empty when a > b
+static inline uint32_t bit_range(size_t a, size_t b) {
+    return a > b ? 0 : (0xFFFFFFFFu << a) & (0xFFFFFFFFu >> (31 - b));
+}
+
+NumberAllocator::NumberAllocator(uint16_t first, uint16_t last, uint16_t zone_size_) : policy(NUMBER_POLICY_LOWEST) {
+    if (!configure(first, last, zone_size_)) {
+        configure(ASSIGNMENT_NUMBER_FIRST, ASSIGNMENT_NUMBER_LAST, ASSIGNMENT_ZONE_SIZE);
+    }
+}
+
+bool NumberAllocator::configure(uint16_t first, uint16_t last, uint16_t zone_size_) {
+    size_t count = (size_t)last - first + 1;
+    if (first == 0 || last < first || count > NUMBER_ALLOCATOR_CAPACITY || zone_size_ == 0 ||
+        (count + zone_size_ - 1) / zone_size_ > NUMBER_ALLOCATOR_MAX_ZONES) {
+        log_error(0x03, "Invalid number range");
+        return false;
+    }
+    first_number = first;
+    last_number = last;
+    zone_size = zone_size_;
+    zones = (count + zone_size - 1) / zone_size;
+    reset();
+    return true;
+}
+
+void NumberAllocator::reset() {
+    size_t count = (size_t)last_number - first_number + 1;
+
+    // Positions past the range stay permanently taken so a partly used
+    // last word still reads as full once its real numbers are gone
+    full_words = 0;
+    for (size_t w = 0; w < NUMBER_ALLOCATOR_WORDS; w++) {
+        size_t base = w * 32;
+        words[w] = base >= count ? 0xFFFFFFFFu : ~bit_range(0, count - base > 32 ? 31 : count - base - 1);
+        if (words[w] == 0xFFFFFFFFu) {
+            full_words |= 1u << w;
+        }
+    }
+    for (size_t z = 0; z < NUMBER_ALLOCATOR_MAX_ZONES; z++) {
+        size_t start = z * zone_size;
+        zone_free[z] = z < zones ? (uint16_t)(count - start < zone_size ? count - start : zone_size) : 0;
+    }
+    free_count = count;
+}
+
+int NumberAllocator::findFree(size_t low, size_t high) const {
+    size_t first_word = low >> 5;
+    size_t last_word = high >> 5;
+    uint32_t low_mask = bit_range(low & 31, 31);
+    uint32_t high_mask = bit_range(0, high & 31);
+
+    if (first_word == last_word) {
+        uint32_t free_bits = ~words[first_word] & low_mask & high_mask;
+        return free_bits ? (int)(first_word * 32 + __builtin_ctz(free_bits)) : -1;
+    }
+
+    uint32_t free_bits = ~words[first_word] & low_mask;
+    if (free_bits) {
+        return (int)(first_word * 32 + __builtin_ctz(free_bits));
+    }
+
+    // Whole words in between: any word not marked full has a free bit
+    uint32_t open_words = ~full_words & bit_range(first_word + 1, last_word - 1);
+    if (open_words) {
+        size_t w = __builtin_ctz(open_words);
+        return (int)(w * 32 + __builtin_ctz(~words[w]));
+    }
+
+    free_bits = ~words[last_word] & high_mask;
+    return free_bits ? (int)(last_word * 32 + __builtin_ctz(free_bits)) : -1;
+}
+
+uint16_t NumberAllocator::take(int bit) {
+    size_t w = (size_t)bit >> 5;
+    words[w] |= 1u << (bit & 31);
+    if (words[w] == 0xFFFFFFFFu) {
+        full_words |= 1u << w;
+    }
+    zone_free[bit / zone_size]--;
+    free_count--;
+    return (uint16_t)(first_number + bit);
+}
+
+uint16_t NumberAllocator::allocateInZone(int zone) {
+    if (zone < 0 || (size_t)zone >= zones || zone_free[zone] == 0) {
+        return 0;
+    }
+    size_t low = (size_t)zone * zone_size;
+    size_t high = low + zone_size - 1;
+    size_t last = (size_t)last_number - first_number;
+    int bit = findFree(low, high < last ? high : last);
+    return bit >= 0 ? take(bit) : 0;
+}
+
+uint16_t NumberAllocator::allocate(int zone) {
+    if (free_count == 0) {
+        return 0;
+    }
+
+    if (policy == NUMBER_POLICY_BALANCE) {
+        int emptiest = 0;
+        for (size_t z = 1; z < zones; z++) {
+            if (zone_free[z] > zone_free[emptiest]) {
+                emptiest = (int)z;
+            }
+        }
+        return allocateInZone(emptiest);
+    }
+
+    if (policy == NUMBER_POLICY_AFFINITY && zone >= 0 && (size_t)zone < zones) {
+        // Requested rack, then alternate outwards to its neighbours
+        for (size_t distance = 0; distance < zones; distance++) {
+            uint16_t number = allocateInZone(zone + (int)distance);
+            if (!number && distance > 0) {
+                number = allocateInZone(zone - (int)distance);
+            }
+            if (number) {
+                return number;
+            }
+        }
+        return 0;
+    }
+
+    int bit = findFree(0, (size_t)last_number - first_number);
+    return bit >= 0 ? take(bit) : 0;
+}
+
+bool NumberAllocator::reserve(uint16_t number) {
+    if (number < first_number || number > last_number || isAllocated(number)) {
+        return false;
+    }
+    take(number - first_number);
+    return true;
+}
+
+bool NumberAllocator::release(uint16_t number) {
+    if (number < first_number || number > last_number || !isAllocated(number)) {
+        return false;
+    }
+    size_t bit = number - first_number;
+    words[bit >> 5] &= ~(1u << (bit & 31));
+    full_words &= ~(1u << (bit >> 5));
+    zone_free[bit / zone_size]++;
+    free_count++;
+    return true;
+}
+
+bool NumberAllocator::isAllocated(uint16_t number) const {
+    if (number < first_number || number > last_number) {
+        return false;
+    }
+    size_t bit = number - first_number;
+    return (words[bit >> 5] >> (bit & 31)) & 1;
+}
+
+int NumberAllocator::zoneOf(uint16_t number) const {
+    if (number < first_number || number > last_number) {
+        return -1;
+    }
+    return (number - first_number) / zone_size;
+}
+
+size_t NumberAllocator::zoneAvailable(int zone) const {
+    return (zone >= 0 && (size_t)zone < zones) ? zone_free[zone] : 0;
+}
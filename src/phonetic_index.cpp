@@ -0,0 +1,378 @@
+// Phonetic keys and fuzzy keyword lookup for the voice profile store
+#include "phonetic_index.h"
+#include "keyword_index.h"
+#include <cstring>
+
+#define PHONETIC_MIN_FUZZY_LENGTH 4   // shorter keys only match exactly
+
+static inline bool is_vowel(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+}
+
+static inline bool is_front_vowel(char c) {
+    return c == 'e' || c == 'i' || c == 'y';
+}
+
+// Simplified Metaphone over one lower-case word
+static size_t encode_word(const char* word, size_t length, char* out, size_t room) {
+    size_t written = 0;
+    char last = 0;
+
+    auto at = [&](size_t i) -> char { return i < length ? word[i] : 0; };
+    auto emit = [&](char code) {
+        if (code != last && written < room) {
+            out[written++] = code;
+        }
+        last = code;
+    };
+
+    size_t i = 0;
+    // Silent leading letter: knight, gnome, pneumatic, wrist, aesthetic
+    if (length >= 2) {
+        char a = word[0], b = word[1];
+        if ((b == 'n' && (a == 'k' || a == 'g' || a == 'p')) || (a == 'w' && b == 'r') || (a == 'a' && b == 'e')) {
+            i = 1;
+        }
+    }
+
+    for (; i < length; i++) {
+        char c = word[i];
+        char prev = i > 0 ? word[i - 1] : 0;
+        char next = at(i + 1);
+        if (c == prev && c != 'c') {
+            continue;
+        }
+
+        switch (c) {
+        case 'a': case 'e': case 'i': case 'o': case 'u':
+            // Only a leading vowel is coded; inner ones just separate consonants
+            if (i == 0) {
+                emit('A');
+            } else {
+                last = 0;
+            }
+            break;
+        case 'b':
+            if (!(prev == 'm' && i + 1 == length)) {
+                emit('B');
+            }
+            break;
+        case 'c':
+            if (next == 'i' && at(i + 2) == 'a') {
+                emit('X');
+            } else if (next == 'h') {
+                emit('X');
+                i++;
+            } else if (is_front_vowel(next)) {
+                emit('S');
+            } else {
+                emit('K');
+            }
+            break;
+        case 'd':
+            if (next == 'g' && is_front_vowel(at(i + 2))) {
+                emit('J');
+                i += 2;
+            } else {
+                emit('T');
+            }
+            break;
+        case 'g':
+            if (next == 'h') {
+                // Silent before a consonant or at the end: night, high
+                if (i + 2 < length && is_vowel(at(i + 2))) {
+                    emit('K');
+                }
+                i++;
+            } else if (next == 'n' && i + 2 == length) {
+                // sign
+            } else if (is_front_vowel(next)) {
+                emit('J');
+            } else {
+                emit('K');
+            }
+            break;
+        case 'h':
+            if (is_vowel(next) && !strchr("csptg", prev ? prev : '-')) {
+                emit('H');
+            }
+            break;
+        case 'k':
+            if (prev != 'c') {
+                emit('K');
+            }
+            break;
+        case 'p':
+            if (next == 'h') {
+                emit('F');
+                i++;
+            } else {
+                emit('P');
+            }
+            break;
+        case 'q':
+            emit('K');
+            break;
+        case 's':
+            if (next == 'h') {
+                emit('X');
+                i++;
+            } else if (next == 'i' && (at(i + 2) == 'o' || at(i + 2) == 'a')) {
+                emit('X');
+            } else {
+                emit('S');
+            }
+            break;
+        case 't':
+            if (next == 'h') {
+                emit('0');
+                i++;
+            } else if (next == 'i' && (at(i + 2) == 'o' || at(i + 2) == 'a')) {
+                emit('X');
+            } else {
+                emit('T');
+            }
+            break;
+        case 'v':
+            emit('F');
+            break;
+        case 'w':
+        case 'y':
+            if (is_vowel(next)) {
+                emit(c == 'w' ? 'W' : 'Y');
+            }
+            break;
+        case 'x':
+            if (i == 0) {
+                emit('S');
+            } else {
+                emit('K');
+                emit('S');
+            }
+            break;
+        case 'z':
+            emit('S');
+            break;
+        default:
+            // f j l m n r and digits code as themselves
+            emit(c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c);
+            break;
+        }
+    }
+    return written;
+}
+
+size_t keyword_phonetic_key(const char* keyword, char* out, size_t out_size) {
+    char normalized[KEYWORD_MAX_LENGTH];
+    size_t length = keyword_normalize(keyword, normalized, sizeof(normalized));
+    size_t written = 0;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+    size_t start = 0;
+    while (start < length) {
+        size_t end = start;
+        while (end < length && normalized[end] != ' ') {
+            end++;
+        }
+        if (written > 0 && written + 1 < out_size) {
+            out[written++] = ' ';
+        }
+        written += encode_word(normalized + start, end - start, out + written, out_size - 1 - written);
+        start = end + 1;
+    }
+
+    out[written] = '\0';
+    return written;
+}
+
+int keyword_edit_distance(const char* a, const char* b, int limit) {
+    size_t length_a = strlen(a);
+    size_t length_b = strlen(b);
+    if (length_a > KEYWORD_MAX_LENGTH || length_b > KEYWORD_MAX_LENGTH) {
+        return limit + 1;
+    }
+    int difference = (int)length_a - (int)length_b;
+    if (difference > limit || -difference > limit) {
+        return limit + 1;
+    }
+
+    // Two rows of the DP table; stop once a whole row is past the limit
+    int previous[KEYWORD_MAX_LENGTH + 1];
+    int current[KEYWORD_MAX_LENGTH + 1];
+    for (size_t j = 0; j <= length_b; j++) {
+        previous[j] = (int)j;
+    }
+
+    for (size_t i = 1; i <= length_a; i++) {
+        current[0] = (int)i;
+        int row_min = current[0];
+        for (size_t j = 1; j <= length_b; j++) {
+            int substitute = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            int erase = previous[j] + 1;
+            int insert = current[j - 1] + 1;
+            int best = substitute < erase ? substitute : erase;
+            current[j] = best < insert ? best : insert;
+            if (current[j] < row_min) {
+                row_min = current[j];
+            }
+        }
+        if (row_min > limit) {
+            return limit + 1;
+        }
+        memcpy(previous, current, (length_b + 1) * sizeof(int));
+    }
+    return previous[length_b] <= limit ? previous[length_b] : limit + 1;
+}
+
+// Fuzzy tolerance for a key; very short keys collide too easily
+static inline int key_tolerance(const char* key, int max_distance) {
+    return strlen(key) < PHONETIC_MIN_FUZZY_LENGTH ? 0 : max_distance;
+}
+
+bool keyword_similar(const char* a, const char* b) {
+    if (keyword_equal(a, b)) {
+        return true;
+    }
+    char key_a[PHONETIC_KEY_SIZE];
+    char key_b[PHONETIC_KEY_SIZE];
+    keyword_phonetic_key(a, key_a, sizeof(key_a));
+    keyword_phonetic_key(b, key_b, sizeof(key_b));
+    if (key_a[0] == '\0') {
+        return false;
+    }
+    int tolerance = key_tolerance(key_a, PHONETIC_MAX_DISTANCE);
+    return keyword_edit_distance(key_a, key_b, tolerance) <= tolerance;
+}
+
+PhoneticIndex::PhoneticIndex(size_t max_slots) : slot_next(max_slots, -1) {
+    nodes.reserve(64);
+}
+
+int PhoneticIndex::findNode(const char* key) const {
+    int node = nodes.empty() ? -1 : 0;
+    while (node >= 0) {
+        int distance = keyword_edit_distance(key, nodes[node].key, PHONETIC_KEY_SIZE);
+        if (distance == 0) {
+            return node;
+        }
+        int child = nodes[node].first_child;
+        while (child >= 0 && nodes[child].distance != distance) {
+            child = nodes[child].next_sibling;
+        }
+        node = child;
+    }
+    return -1;
+}
+
+bool PhoneticIndex::insert(const char* keyword, int16_t slot) {
+    char key[PHONETIC_KEY_SIZE];
+    if (slot < 0 || (size_t)slot >= slot_next.size() || keyword_phonetic_key(keyword, key, sizeof(key)) == 0) {
+        return false;
+    }
+
+    int node = -1;
+    int parent = nodes.empty() ? -1 : 0;
+    uint8_t edge = 0;
+    while (parent >= 0) {
+        int distance = keyword_edit_distance(key, nodes[parent].key, PHONETIC_KEY_SIZE);
+        if (distance == 0) {
+            node = parent;
+            break;
+        }
+        int child = nodes[parent].first_child;
+        while (child >= 0 && nodes[child].distance != distance) {
+            child = nodes[child].next_sibling;
+        }
+        if (child < 0) {
+            edge = (uint8_t)distance;
+            break;
+        }
+        parent = child;
+    }
+
+    if (node < 0) {
+        if (nodes.size() >= (size_t)INT16_MAX) {
+            return false;
+        }
+        PhoneticNode fresh = {};
+        strncpy(fresh.key, key, sizeof(fresh.key) - 1);
+        fresh.first_child = -1;
+        fresh.first_slot = -1;
+        fresh.distance = edge;
+        fresh.next_sibling = parent >= 0 ? nodes[parent].first_child : -1;
+        node = (int)nodes.size();
+        nodes.push_back(fresh);
+        if (parent >= 0) {
+            nodes[parent].first_child = (int16_t)node;
+        }
+    }
+
+    slot_next[slot] = nodes[node].first_slot;
+    nodes[node].first_slot = slot;
+    return true;
+}
+
+bool PhoneticIndex::remove(const char* keyword, int16_t slot) {
+    char key[PHONETIC_KEY_SIZE];
+    keyword_phonetic_key(keyword, key, sizeof(key));
+    int node = findNode(key);
+    if (node < 0) {
+        return false;
+    }
+
+    // Nodes stay in the tree when empty; they still route searches
+    int16_t* link = &nodes[node].first_slot;
+    while (*link >= 0) {
+        if (*link == slot) {
+            *link = slot_next[slot];
+            slot_next[slot] = -1;
+            return true;
+        }
+        link = &slot_next[*link];
+    }
+    return false;
+}
+
+size_t PhoneticIndex::find(const char* keyword, int max_distance, int16_t* slots, size_t max_slots) const {
+    char key[PHONETIC_KEY_SIZE];
+    if (nodes.empty() || keyword_phonetic_key(keyword, key, sizeof(key)) == 0) {
+        return 0;
+    }
+    int tolerance = key_tolerance(key, max_distance);
+
+    size_t count = 0;
+    pending.clear();
+    pending.push_back(0);
+    while (!pending.empty() && count < max_slots) {
+        int node = pending.back();
+        pending.pop_back();
+
+        int distance = keyword_edit_distance(key, nodes[node].key, PHONETIC_KEY_SIZE);
+        if (distance <= tolerance) {
+            for (int16_t slot = nodes[node].first_slot; slot >= 0 && count < max_slots; slot = slot_next[slot]) {
+                slots[count++] = slot;
+            }
+        }
+
+        // Triangle inequality: only children at distance - tolerance ..
+        // distance + tolerance from this node can be within range
+        for (int child = nodes[node].first_child; child >= 0; child = nodes[child].next_sibling) {
+            int edge = nodes[child].distance;
+            if (edge >= distance - tolerance && edge <= distance + tolerance) {
+                pending.push_back((int16_t)child);
+            }
+        }
+    }
+    return count;
+}
+
+void PhoneticIndex::clear() {
+    nodes.clear();
+    pending.clear();
+    for (size_t i = 0; i < slot_next.size(); i++) {
+        slot_next[i] = -1;
+    }
+}
@@ -0,0 +1,298 @@
+// Prerendered number announcements
+#include "phrase_cache.h"
+#include "error_handler.h"
+#include <algorithm>
+#include <cstring>
+
+#define PHRASE_HEADER_SIZE 16
+#define PHRASE_ENTRY_SIZE (PHRASE_KEY_SIZE + 8)
+
+static const PhraseSource vocabulary[] = {
+    {"p_stored", "Your items are stored as number"},
+    {"p_retrieve", "Your items are number"},
+    {"p_registered", "You are already registered as number"},
+    {"n_0", "zero"}, {"n_1", "one"}, {"n_2", "two"}, {"n_3", "three"}, {"n_4", "four"},
+    {"n_5", "five"}, {"n_6", "six"}, {"n_7", "seven"}, {"n_8", "eight"}, {"n_9", "nine"},
+    {"n_10", "ten"}, {"n_11", "eleven"}, {"n_12", "twelve"}, {"n_13", "thirteen"},
+    {"n_14", "fourteen"}, {"n_15", "fifteen"}, {"n_16", "sixteen"}, {"n_17", "seventeen"},
+    {"n_18", "eighteen"}, {"n_19", "nineteen"},
+    {"n_20", "twenty"}, {"n_30", "thirty"}, {"n_40", "forty"}, {"n_50", "fifty"},
+    {"n_60", "sixty"}, {"n_70", "seventy"}, {"n_80", "eighty"}, {"n_90", "ninety"},
+    {"n_hundred", "hundred"},
+};
+
+// Keys for 0-99 share storage with the vocabulary table
+static const char* const unit_keys[20] = {
+    "n_0", "n_1", "n_2", "n_3", "n_4", "n_5", "n_6", "n_7", "n_8", "n_9",
+    "n_10", "n_11", "n_12", "n_13", "n_14", "n_15", "n_16", "n_17", "n_18", "n_19",
+};
+static const char* const tens_keys[10] = {
+    nullptr, nullptr, "n_20", "n_30", "n_40", "n_50", "n_60", "n_70", "n_80", "n_90",
+};
+static const char* const prefix_keys[] = {"p_stored", "p_retrieve", "p_registered"};
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool entry_less(const PhraseEntry& a, const PhraseEntry& b) {
+    return strncmp(a.key, b.key, PHRASE_KEY_SIZE) < 0;
+}
+
+const PhraseSource* phrase_vocabulary(size_t* count) {
+    *count = sizeof(vocabulary) / sizeof(vocabulary[0]);
+    return vocabulary;
+}
+
+size_t phrase_announcement_keys(PhrasePrefix prefix, uint16_t number, const char* keys[PHRASE_MAX_KEYS]) {
+    size_t count = 0;
+    keys[count++] = prefix_keys[prefix];
+
+    if (number > 999) {
+        return 0;
+    }
+
+    uint16_t hundreds = number / 100;
+    uint16_t rest = number % 100;
+    if (hundreds > 0) {
+        keys[count++] = unit_keys[hundreds];
+        keys[count++] = "n_hundred";
+    }
+    if (rest >= 20) {
+        keys[count++] = tens_keys[rest / 10];
+        if (rest % 10) {
+            keys[count++] = unit_keys[rest % 10];
+        }
+    } else if (rest > 0 || hundreds == 0) {
+        keys[count++] = unit_keys[rest];
+    }
+    return count;
+}
+
+void phrase_crossfade_append(std::vector<int16_t>& out, const int16_t* clip, size_t samples, size_t fade_samples) {
+    size_t fade = std::min(fade_samples, std::min(out.size(), samples));
+    size_t base = out.size() - fade;
+
+    // Linear Q15 ramp across the overlap: the tail fades out as the head fades in
+    for (size_t i = 0; i < fade; i++) {
+        int32_t in_weight = (int32_t)((i << 15) / fade);
+        int32_t mixed = ((int32_t)out[base + i] * (32768 - in_weight) + (int32_t)clip[i] * in_weight) >> 15;
+        out[base + i] = (int16_t)mixed;
+    }
+    out.insert(out.end(), clip + fade, clip + samples);
+}
+
+size_t phrase_trim_silence(int16_t* pcm, size_t samples, int16_t threshold) {
+    size_t start = 0;
+    while (start < samples && pcm[start] < threshold && pcm[start] > -threshold) {
+        start++;
+    }
+    size_t end = samples;
+    while (end > start && pcm[end - 1] < threshold && pcm[end - 1] > -threshold) {
+        end--;
+    }
+
+    // Keep a fade's worth of lead-in and tail so the crossfade has room
+    start = start > PHRASE_CROSSFADE_SAMPLES ? start - PHRASE_CROSSFADE_SAMPLES : 0;
+    end = std::min(samples, end + PHRASE_CROSSFADE_SAMPLES);
+
+    size_t kept = end - start;
+    if (start > 0) {
+        memmove(pcm, pcm + start, kept * sizeof(int16_t));
+    }
+    return kept;
+}
+
+PhraseCache::PhraseCache() : file(nullptr), sample_rate(0) {}
+
+PhraseCache::~PhraseCache() {
+    close();
+}
+
+bool PhraseCache::open(const char* path) {
+    log_entry("PhraseCache::open");
+    close();
+
+    file = fopen(path, "rb");
+    if (!file) {
+        log_exit("PhraseCache::open");
+        return false;
+    }
+
+    uint8_t header[PHRASE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "SLPC", 4) != 0 ||
+        get_u16(header + 4) != PHRASE_CACHE_VERSION) {
+        log_error(0x06, "Phrase cache header invalid");
+        close();
+        log_exit("PhraseCache::open");
+        return false;
+    }
+
+    uint16_t count = get_u16(header + 6);
+    sample_rate = get_u32(header + 8);
+    uint32_t index_offset = get_u32(header + 12);
+
+    index.resize(count);
+    bool ok = fseek(file, index_offset, SEEK_SET) == 0;
+    for (uint16_t i = 0; ok && i < count; i++) {
+        uint8_t raw[PHRASE_ENTRY_SIZE];
+        ok = fread(raw, 1, sizeof(raw), file) == sizeof(raw);
+        memcpy(index[i].key, raw, PHRASE_KEY_SIZE);
+        index[i].key[PHRASE_KEY_SIZE - 1] = '\0';
+        index[i].offset = get_u32(raw + PHRASE_KEY_SIZE);
+        index[i].samples = get_u32(raw + PHRASE_KEY_SIZE + 4);
+    }
+    if (!ok) {
+        log_error(0x06, "Phrase cache index truncated");
+        close();
+        log_exit("PhraseCache::open");
+        return false;
+    }
+
+    log_performance("phrase_cache_clips", (float)count);
+    log_exit("PhraseCache::open");
+    return true;
+}
+
+void PhraseCache::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    index.clear();
+}
+
+const PhraseEntry* PhraseCache::find(const char* key) const {
+    PhraseEntry probe;
+    strncpy(probe.key, key, PHRASE_KEY_SIZE - 1);
+    probe.key[PHRASE_KEY_SIZE - 1] = '\0';
+
+    auto it = std::lower_bound(index.begin(), index.end(), probe, entry_less);
+    if (it != index.end() && strncmp(it->key, probe.key, PHRASE_KEY_SIZE) == 0) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+bool PhraseCache::appendClip(const char* key, std::vector<int16_t>& out) {
+    const PhraseEntry* entry = find(key);
+    if (!file || !entry) {
+        return false;
+    }
+
+    scratch.resize(entry->samples);
+    if (fseek(file, entry->offset, SEEK_SET) != 0 ||
+        fread(scratch.data(), sizeof(int16_t), entry->samples, file) != entry->samples) {
+        log_error(0x06, "Phrase clip read failed");
+        return false;
+    }
+
+    phrase_crossfade_append(out, scratch.data(), scratch.size());
+    return true;
+}
+
+bool PhraseCache::renderAnnouncement(PhrasePrefix prefix, uint16_t number, std::vector<int16_t>& out) {
+    const char* keys[PHRASE_MAX_KEYS];
+    size_t count = phrase_announcement_keys(prefix, number, keys);
+    out.clear();
+    if (count == 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!appendClip(keys[i], out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PhraseCacheBuilder::PhraseCacheBuilder() : file(nullptr), sample_rate(0), data_end(0) {}
+
+PhraseCacheBuilder::~PhraseCacheBuilder() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool PhraseCacheBuilder::begin(const char* path, uint32_t rate) {
+    file = fopen(path, "wb");
+    if (!file) {
+        log_error(0x06, "Cannot create phrase cache");
+        return false;
+    }
+
+    // Placeholder header; finish() rewrites it once the index offset is known
+    uint8_t header[PHRASE_HEADER_SIZE] = {0};
+    sample_rate = rate;
+    data_end = PHRASE_HEADER_SIZE;
+    entries.clear();
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool PhraseCacheBuilder::addClip(const char* key, const int16_t* pcm, size_t samples) {
+    if (!file || samples == 0) {
+        return false;
+    }
+
+    PhraseEntry entry;
+    memset(entry.key, 0, sizeof(entry.key));
+    strncpy(entry.key, key, PHRASE_KEY_SIZE - 1);
+    entry.offset = data_end;
+    entry.samples = (uint32_t)samples;
+
+    if (fwrite(pcm, sizeof(int16_t), samples, file) != samples) {
+        log_error(0x06, "Phrase cache write failed");
+        return false;
+    }
+    data_end += samples * sizeof(int16_t);
+    entries.push_back(entry);
+    return true;
+}
+
+bool PhraseCacheBuilder::finish() {
+    if (!file) {
+        return false;
+    }
+
+    std::sort(entries.begin(), entries.end(), entry_less);
+
+    bool ok = true;
+    for (const PhraseEntry& entry : entries) {
+        uint8_t raw[PHRASE_ENTRY_SIZE];
+        memcpy(raw, entry.key, PHRASE_KEY_SIZE);
+        put_u32(raw + PHRASE_KEY_SIZE, entry.offset);
+        put_u32(raw + PHRASE_KEY_SIZE + 4, entry.samples);
+        ok = ok && fwrite(raw, 1, sizeof(raw), file) == sizeof(raw);
+    }
+
+    uint8_t header[PHRASE_HEADER_SIZE];
+    memcpy(header, "SLPC", 4);
+    put_u16(header + 4, PHRASE_CACHE_VERSION);
+    put_u16(header + 6, (uint16_t)entries.size());
+    put_u32(header + 8, sample_rate);
+    put_u32(header + 12, data_end);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    fclose(file);
+    file = nullptr;
+    if (!ok) {
+        log_error(0x06, "Phrase cache finalize failed");
+    }
+    return ok;
+}
@@ -0,0 +1,117 @@
+// Incremental YIN pitch estimation for VoiceProfile::pitch_average
+#include "pitch_tracker.h"
+#include <cstring>
+
+#define YIN_THRESHOLD 0.15f
+#define PITCH_SAMPLE_SHIFT 4          // 12-bit samples keep a window of squared diffs in 32 bits
+#define PITCH_MIN_FRAME_ENERGY 2000u  // sum of squares below this is silence
+
+PitchTracker::PitchTracker() {
+    reset();
+}
+
+void PitchTracker::reset() {
+    fill = 0;
+    decimator_history[0] = 0;
+    decimator_history[1] = 0;
+    decimator_phase = false;
+    last_pitch = 0.0f;
+    frames = 0;
+    voiced_frames = 0;
+    pitch_mean = 0.0f;
+    pitch_m2 = 0.0f;
+}
+
+void PitchTracker::pushSamples(const int16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        // [1 2 1] / 4 low-pass, keeping every other output
+        int32_t filtered = ((int32_t)decimator_history[1] + 2 * (int32_t)decimator_history[0] + samples[i]) >> 2;
+        decimator_history[1] = decimator_history[0];
+        decimator_history[0] = samples[i];
+
+        decimator_phase = !decimator_phase;
+        if (!decimator_phase) {
+            continue;
+        }
+
+        buffer[fill++] = (int16_t)(filtered >> PITCH_SAMPLE_SHIFT);
+        if (fill == PITCH_BUFFER) {
+            analyzeFrame();
+            memmove(buffer, buffer + PITCH_HOP, (PITCH_BUFFER - PITCH_HOP) * sizeof(int16_t));
+            fill = PITCH_BUFFER - PITCH_HOP;
+        }
+    }
+}
+
+PitchStats PitchTracker::getStats() const {
+    PitchStats stats;
+    stats.frames = frames;
+    stats.voiced_frames = voiced_frames;
+    stats.mean_hz = voiced_frames > 0 ? pitch_mean : 0.0f;
+    stats.variance_hz2 = voiced_frames > 1 ? pitch_m2 / (float)(voiced_frames - 1) : 0.0f;
+    stats.voiced_ratio = frames > 0 ? (float)voiced_frames / (float)frames : 0.0f;
+    return stats;
+}
+
+void PitchTracker::analyzeFrame() {
+    frames++;
+    last_pitch = 0.0f;
+
+    uint32_t energy = 0;
+    for (int j = 0; j < PITCH_WINDOW; j++) {
+        int32_t s = buffer[j];
+        energy += (uint32_t)(s * s);
+    }
+    if (energy < PITCH_MIN_FRAME_ENERGY) {
+        return;
+    }
+
+    // Cumulative mean normalized difference, computed lag by lag so the
+    // search can stop right after the first dip below the threshold
+    float normalized[PITCH_MAX_LAG + 2];
+    float running_sum = 0.0f;
+    int best_lag = -1;
+    normalized[0] = 1.0f;
+
+    for (int lag = 1; lag <= PITCH_MAX_LAG + 1; lag++) {
+        uint32_t difference = 0;
+        for (int j = 0; j < PITCH_WINDOW; j++) {
+            int32_t d = (int32_t)buffer[j] - (int32_t)buffer[j + lag];
+            difference += (uint32_t)(d * d);
+        }
+        running_sum += (float)difference;
+        normalized[lag] = running_sum > 0.0f ? (float)difference * lag / running_sum : 1.0f;
+
+        if (best_lag < 0) {
+            if (lag >= PITCH_MIN_LAG && lag <= PITCH_MAX_LAG && normalized[lag] < YIN_THRESHOLD) {
+                best_lag = lag;
+            }
+        } else if (normalized[lag] < normalized[best_lag]) {
+            best_lag = lag;   // still descending into the dip
+        } else {
+            break;            // past the local minimum; lag + 1 is already computed
+        }
+    }
+
+    if (best_lag < 0 || best_lag > PITCH_MAX_LAG) {
+        return;
+    }
+
+    // Parabolic interpolation around the dip
+    float refined = (float)best_lag;
+    float left = normalized[best_lag - 1];
+    float center = normalized[best_lag];
+    float right = normalized[best_lag + 1];
+    float denominator = left - 2.0f * center + right;
+    if (denominator > 0.0f) {
+        refined += 0.5f * (left - right) / denominator;
+    }
+
+    last_pitch = (float)PITCH_SAMPLE_RATE / refined;
+    voiced_frames++;
+
+    // Welford running mean and variance
+    float delta = last_pitch - pitch_mean;
+    pitch_mean += delta / (float)voiced_frames;
+    pitch_m2 += delta * (last_pitch - pitch_mean);
+}
@@ -9,33 +9,21 @@
 // Include modular components (with fallbacks if headers missing)
 #ifdef USE_MODULAR_SYSTEM
 #include "voice_processor.h"
-#include "display_manager.h" 
 #include "error_handler.h"
 #include "storage_manager.h"
 #endif
+#include "display_manager.h"
+#include "voice_matcher.h"
+#include "storage_manager.h"
 
 // Configuration - UPDATE THESE FOR HACKATHON!
 
 #include "secrets.h"
 // Demo data and state
-uint16_t demo_numbers[] = {42, 123, 456, 789, 101, 234, 567, 890};
-int current_demo_index = 0;
 bool wifi_connected = false;
 bool api_enabled = false;
 
-// Voice profile simulation
-struct DemoProfile {
-    const char* keyword;
-    uint32_t voice_hash;
-    uint16_t number;
-};
-
-DemoProfile registered_users[] = {
-    {"Helsinki winter", 0xABCDEF01, 42},
-    {"Midnight sun", 0x12345678, 123},
-    {"Aurora lights", 0x87654321, 456}
-};
-int registered_count = 0;
+// Registered guests live in the storage_manager profile table
 
 // Function prototypes
 void initializeSystem();
@@ -45,6 +33,7 @@ void updateDisplay(const char* status, int color = WHITE, const char* extra = ""
 void connectWiFi();
 bool processVoiceWithAPI(const char* simulated_keyword = "Helsinki winter");
 uint32_t generateVoiceHash(const char* keyword);
+VoiceFeatures simulateVoiceFeatures(const char* keyword);
 
 void setup() {
     Serial.begin(115200);
@@ -83,12 +72,12 @@ void loop() {
     // System Status
     if (M5.BtnC.wasPressed()) {
         Serial.println("\n📊 === SYSTEM STATUS ===");
-        Serial.printf("Registered Users: %d\n", registered_count);
-        Serial.printf("Next Number: %d\n", demo_numbers[current_demo_index]);
+        Serial.printf("Registered Users: %d\n", active_profile_count());
+        Serial.printf("Free Numbers: %d\n", assignment_numbers_available());
         Serial.printf("Free Memory: %d bytes\n", ESP.getFreeHeap());
         Serial.printf("Uptime: %lu seconds\n", millis() / 1000);
         
-        updateDisplay("STATUS", CYAN, String(registered_count).c_str());
+        updateDisplay("STATUS", CYAN, String(active_profile_count()).c_str());
         delay(2000);
         updateDisplay("READY", GREEN);
     }
@@ -103,8 +92,9 @@ void initializeSystem() {
     M5.begin(cfg);
     
     // Setup display
-    M5.Display.setTextSize(2);
     M5.Display.setRotation(2);
+    const DisplayLayout layout = {10, 10, 35, 65, 90};
+    display_begin(layout);
     updateDisplay("STARTING...", YELLOW);
     
     // Initialize WiFi (non-blocking)
@@ -142,6 +132,8 @@ void connectWiFi() {
     if (WiFi.status() == WL_CONNECTED) {
         wifi_connected = true;
         Serial.printf("\n✅ WiFi connected! IP: %s\n", WiFi.localIP().toString().c_str());
+        // Wall clock for profile timestamps; storage re-ages restored rows once it is set
+        configTime(0, 0, PROFILE_NTP_SERVER);
     } else {
         Serial.println("\n⚠️  WiFi connection failed - continuing in offline mode");
     }
@@ -177,39 +169,34 @@ void handleRegistration() {
         return;
     }
     
-    // Generate voice biometric hash
+    // Generate voice biometric hash and features
     uint32_t voice_hash = generateVoiceHash(recognized_keyword);
+    VoiceFeatures voice_features = simulateVoiceFeatures(recognized_keyword);
     
-    // Check if already registered
-    bool already_registered = false;
-    uint16_t existing_number = 0;
-    
-    for (int i = 0; i < registered_count; i++) {
-        if (strcmp(registered_users[i].keyword, recognized_keyword) == 0 && 
-            registered_users[i].voice_hash == voice_hash) {
-            already_registered = true;
-            existing_number = registered_users[i].number;
-            break;
-        }
-    }
+    // Check if already registered (keyword index lookup, then voice scoring)
+    int existing = match_voice_profile(recognized_keyword, voice_features);
     
-    if (already_registered) {
+    if (existing >= 0) {
+        uint16_t existing_number = profile_assignment_number(existing);
         Serial.printf("👤 User already registered with number: %d\n", existing_number);
         updateDisplay("ALREADY", ORANGE, String(existing_number).c_str());
         delay(3000);
     } else {
-        // Register new user
-        uint16_t assigned_number = demo_numbers[current_demo_index];
-        current_demo_index = (current_demo_index + 1) % 8;
-        
-        // Store in demo database
-        if (registered_count < 3) {
-            registered_users[registered_count] = {
-                strdup(recognized_keyword), // Note: memory leak in demo - fix for production
-                voice_hash,
-                assigned_number
-            };
-            registered_count++;
+        // Register new user; the profile table assigns the number
+        VoiceProfile profile = {};
+        strncpy(profile.keyword, recognized_keyword, sizeof(profile.keyword) - 1);
+        profile.voice_hash = voice_hash;
+        profile.pitch_average = voice_features.pitch_average;
+        memcpy(profile.tone_signature, voice_features.tone_signature, sizeof(profile.tone_signature));
+        profile.timestamp = profile_timestamp_now();
+        profile.active = true;
+        uint16_t assigned_number = add_voice_profile(profile);
+        if (!assigned_number) {
+            Serial.println("❌ Registration full");
+            updateDisplay("FULL", RED, "Storage");
+            delay(2000);
+            updateDisplay("READY", GREEN);
+            return;
         }
         
         Serial.printf("✅ NEW USER REGISTERED:\n");
@@ -241,7 +228,7 @@ void handleRetrieval() {
     
     // Process voice for retrieval
     const char* spoken_keyword = "Helsinki winter";
-    uint32_t spoken_hash = generateVoiceHash(spoken_keyword);
+    VoiceFeatures spoken_features = simulateVoiceFeatures(spoken_keyword);
     
     if (api_enabled) {
         Serial.println("🤖 Processing with ElevenLabs API...");
@@ -251,24 +238,20 @@ void handleRetrieval() {
         delay(1000);
     }
     
-    // Find matching profile
-    bool match_found = false;
-    uint16_t found_number = 0;
-    
-    for (int i = 0; i < registered_count; i++) {
-        if (strcmp(registered_users[i].keyword, spoken_keyword) == 0 && 
-            registered_users[i].voice_hash == spoken_hash) {
-            match_found = true;
-            found_number = registered_users[i].number;
-            break;
-        }
-    }
+    // Find the best-scoring profile for this keyword
+    float best_confidence = 0.0f;
+    int match = match_voice_profile(spoken_keyword, spoken_features, &best_confidence);
+    bool match_found = match >= 0;
+    uint16_t found_number = match_found ? profile_assignment_number(match) : 0;
     
     if (match_found) {
         Serial.printf("✅ MATCH FOUND:\n");
-        Serial.printf("   Voice authenticated successfully\n");
+        Serial.printf("   Voice authenticated successfully (%.0f%% confidence)\n", best_confidence * 100.0f);
         Serial.printf("   Item Number: %d\n", found_number);
         
+        // Items collected: the number is free for the next guest
+        deactivate_profile_slot(match);
+        
         updateDisplay("FOUND", GREEN, String(found_number).c_str());
         
         if (api_enabled) {
@@ -288,26 +271,8 @@ void handleRetrieval() {
 }
 
 void updateDisplay(const char* status, int color, const char* extra) {
-    M5.Display.fillScreen(BLACK);
-    M5.Display.setTextColor(color);
-    M5.Display.setTextSize(2);
-    
-    // Main status
-    M5.Display.setCursor(10, 10);
-    M5.Display.print("CLOAKROOM");
-    
-    M5.Display.setCursor(10, 35);
-    M5.Display.print("VOICE ID");
-    
-    M5.Display.setCursor(10, 65);
-    M5.Display.print(status);
-    
-    // Extra info
-    if (extra && strlen(extra) > 0) {
-        M5.Display.setCursor(10, 90);
-        M5.Display.setTextSize(3);
-        M5.Display.print(extra);
-    }
+    // Only the lines that changed are pushed to the panel
+    display_show_status(status, (uint16_t)color, extra);
 }
 
 bool processVoiceWithAPI(const char* simulated_keyword) {
@@ -333,4 +298,19 @@ uint32_t generateVoiceHash(const char* keyword) {
     // Add some "voice" characteristics simulation
     hash ^= (millis() & 0xFFFF0000); // Simulate voice biometric
     return hash;
-}
\ No newline at end of file
+}
+
+VoiceFeatures simulateVoiceFeatures(const char* keyword) {
+    // Deterministic stand-in biometrics: the same simulated speaker every time
+    VoiceFeatures features;
+    uint32_t seed = 0;
+    for (int i = 0; keyword[i]; i++) {
+        seed = seed * 31 + keyword[i];
+    }
+    features.pitch_average = 120.0f + (float)(seed % 120);
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        features.tone_signature[i] = (float)((int)((seed >> 16) % 41) - 20);
+    }
+    return features;
+}
@@ -0,0 +1,411 @@
+// Append-only flash journal and snapshots for the profile table
+#include "profile_journal.h"
+#include "crc32.h"
+#include "error_handler.h"
+#include <cstring>
+
+#define JOURNAL_MAX_PAYLOAD 256
+#define REPLAY_BUFFER_BYTES 4096
+
+static inline void put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static inline void put_le32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static inline uint16_t get_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_float(uint8_t* p, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_le32(p, bits);
+}
+
+static inline float get_float(const uint8_t* p) {
+    uint32_t bits = get_le32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void journal_encode_profile(uint8_t* out, uint16_t slot, const VoiceProfile& profile) {
+    put_le16(out, slot);
+    memcpy(out + 2, profile.keyword, sizeof(profile.keyword));
+    put_le32(out + 34, profile.voice_hash);
+    put_float(out + 38, profile.pitch_average);
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+        put_float(out + 42 + 4 * i, profile.tone_signature[i]);
+    }
+    put_le16(out + 74, profile.assignment_number);
+    put_le32(out + 76, profile.timestamp);
+    out[80] = profile.active ? 1 : 0;
+}
+
+void journal_decode_profile(const uint8_t* in, uint16_t* slot, VoiceProfile* profile) {
+    *slot = get_le16(in);
+    memcpy(profile->keyword, in + 2, sizeof(profile->keyword));
+    profile->keyword[sizeof(profile->keyword) - 1] = '\0';
+    profile->voice_hash = get_le32(in + 34);
+    profile->pitch_average = get_float(in + 38);
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+        profile->tone_signature[i] = get_float(in + 42 + 4 * i);
+    }
+    profile->assignment_number = get_le16(in + 74);
+    profile->timestamp = get_le32(in + 76);
+    profile->active = in[80] != 0;
+}
+
+ProfileJournal::ProfileJournal() : opened(false), journal(nullptr), journal_bytes(0), sequence(0), snapshot_slots(0) {
+    journal_path[0] = '\0';
+    snapshot_path[0] = '\0';
+    pending.reserve(JOURNAL_BATCH_BYTES);
+}
+
+ProfileJournal::~ProfileJournal() {
+    close();
+}
+
+bool ProfileJournal::open(const char* journal_file, const char* snapshot_file) {
+    close();
+    strncpy(journal_path, journal_file, sizeof(journal_path) - 1);
+    journal_path[sizeof(journal_path) - 1] = '\0';
+    strncpy(snapshot_path, snapshot_file, sizeof(snapshot_path) - 1);
+    snapshot_path[sizeof(snapshot_path) - 1] = '\0';
+    opened = true;
+    return true;
+}
+
+void ProfileJournal::close() {
+    if (opened) {
+        flush();
+    }
+    std::lock_guard<std::mutex> guard(file_lock);
+    if (journal) {
+        fclose(journal);
+        journal = nullptr;
+    }
+    opened = false;
+}
+
+void ProfileJournal::appendRecord(JournalRecordType type, const uint8_t* payload, uint16_t length) {
+    if (!opened) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(pending_lock);
+    size_t start = pending.size();
+    pending.resize(start + JOURNAL_HEADER_SIZE + length + JOURNAL_TRAILER_SIZE);
+    uint8_t* record = pending.data() + start;
+
+    record[0] = JOURNAL_MAGIC;
+    record[1] = type;
+    put_le16(record + 2, length);
+    put_le32(record + 4, ++sequence);
+    memcpy(record + JOURNAL_HEADER_SIZE, payload, length);
+    put_le32(record + JOURNAL_HEADER_SIZE + length, crc32_update(0, record, JOURNAL_HEADER_SIZE + length));
+}
+
+void ProfileJournal::appendAdd(uint16_t slot, const VoiceProfile& profile) {
+    uint8_t payload[JOURNAL_PROFILE_SIZE];
+    journal_encode_profile(payload, slot, profile);
+    appendRecord(JOURNAL_ADD, payload, sizeof(payload));
+}
+
+void ProfileJournal::appendDeactivate(uint16_t slot) {
+    uint8_t payload[2];
+    put_le16(payload, slot);
+    appendRecord(JOURNAL_DEACTIVATE, payload, sizeof(payload));
+}
+
+size_t ProfileJournal::pendingBytes() {
+    std::lock_guard<std::mutex> guard(pending_lock);
+    return pending.size();
+}
+
+bool ProfileJournal::flush() {
+    std::lock_guard<std::mutex> guard(file_lock);
+    return flushLocked();
+}
+
+bool ProfileJournal::flushLocked() {
+    // Take the batch under the short lock; the flash write happens outside it
+    std::vector<uint8_t> batch;
+    batch.reserve(JOURNAL_BATCH_BYTES);
+    {
+        std::lock_guard<std::mutex> guard(pending_lock);
+        batch.swap(pending);
+    }
+    if (batch.empty()) {
+        return true;
+    }
+
+    if (!journal) {
+        journal = fopen(journal_path, "ab");
+    }
+    bool ok = journal && fwrite(batch.data(), 1, batch.size(), journal) == batch.size() && fflush(journal) == 0;
+    if (!ok) {
+        // Keep the batch; it goes out ahead of newer records next time
+        log_error(0x06, "Journal write failed");
+        std::lock_guard<std::mutex> guard(pending_lock);
+        batch.insert(batch.end(), pending.begin(), pending.end());
+        pending.swap(batch);
+        if (journal) {
+            fclose(journal);
+            journal = nullptr;
+        }
+        return false;
+    }
+
+    journal_bytes += batch.size();
+    return true;
+}
+
+bool ProfileJournal::loadSnapshot(const JournalApply& apply, uint32_t* snapshot_sequence) {
+    *snapshot_sequence = 0;
+    FILE* file = fopen(snapshot_path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "SLSN", 4) != 0 ||
+        get_le16(header + 4) != SNAPSHOT_VERSION) {
+        fclose(file);
+        log_error(0x06, "Snapshot header invalid");
+        return false;
+    }
+    uint32_t count = get_le32(header + 8);
+    size_t body = (size_t)count * JOURNAL_PROFILE_SIZE;
+
+    // Pass 1: verify the checksum before touching the table
+    std::vector<uint8_t> buffer(REPLAY_BUFFER_BYTES - REPLAY_BUFFER_BYTES % JOURNAL_PROFILE_SIZE);
+    uint32_t crc = crc32_update(0, header, sizeof(header));
+    size_t remaining = body;
+    while (remaining > 0) {
+        size_t chunk = remaining < buffer.size() ? remaining : buffer.size();
+        if (fread(buffer.data(), 1, chunk, file) != chunk) {
+            break;
+        }
+        crc = crc32_update(crc, buffer.data(), chunk);
+        remaining -= chunk;
+    }
+    uint8_t trailer[4];
+    if (remaining > 0 || fread(trailer, 1, sizeof(trailer), file) != sizeof(trailer) || get_le32(trailer) != crc) {
+        fclose(file);
+        log_error(0x06, "Snapshot checksum mismatch");
+        return false;
+    }
+
+    // Pass 2: apply
+    fseek(file, SNAPSHOT_HEADER_SIZE, SEEK_SET);
+    JournalRecord record;
+    record.type = JOURNAL_ADD;
+    record.sequence = get_le32(header + 12);
+    remaining = body;
+    while (remaining > 0) {
+        size_t chunk = remaining < buffer.size() ? remaining : buffer.size();
+        if (fread(buffer.data(), 1, chunk, file) != chunk) {
+            break;
+        }
+        for (size_t offset = 0; offset < chunk; offset += JOURNAL_PROFILE_SIZE) {
+            journal_decode_profile(buffer.data() + offset, &record.slot, &record.profile);
+            apply(record);
+        }
+        remaining -= chunk;
+    }
+    fclose(file);
+
+    snapshot_slots = get_le16(header + 6);
+    *snapshot_sequence = record.sequence;
+    return true;
+}
+
+size_t ProfileJournal::replayJournal(const JournalApply& apply, uint32_t after_sequence) {
+    FILE* file = fopen(journal_path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    size_t applied = 0;
+    size_t good_end = 0;
+    JournalRecord record;
+    uint8_t raw[JOURNAL_HEADER_SIZE + JOURNAL_MAX_PAYLOAD + JOURNAL_TRAILER_SIZE];
+
+    while (fread(raw, 1, JOURNAL_HEADER_SIZE, file) == JOURNAL_HEADER_SIZE) {
+        uint16_t length = get_le16(raw + 2);
+        if (raw[0] != JOURNAL_MAGIC || length > JOURNAL_MAX_PAYLOAD ||
+            fread(raw + JOURNAL_HEADER_SIZE, 1, length + JOURNAL_TRAILER_SIZE, file) != (size_t)(length + JOURNAL_TRAILER_SIZE) ||
+            get_le32(raw + JOURNAL_HEADER_SIZE + length) != crc32_update(0, raw, JOURNAL_HEADER_SIZE + length)) {
+            break;
+        }
+        good_end += JOURNAL_HEADER_SIZE + length + JOURNAL_TRAILER_SIZE;
+
+        record.type = (JournalRecordType)raw[1];
+        record.sequence = get_le32(raw + 4);
+        if (record.sequence > sequence) {
+            sequence = record.sequence;
+        }
+        if (record.sequence <= after_sequence) {
+            continue;   // already covered by the snapshot
+        }
+
+        const uint8_t* payload = raw + JOURNAL_HEADER_SIZE;
+        if (record.type == JOURNAL_ADD && length == JOURNAL_PROFILE_SIZE) {
+            journal_decode_profile(payload, &record.slot, &record.profile);
+        } else if (record.type == JOURNAL_DEACTIVATE && length == 2) {
+            record.slot = get_le16(payload);
+        } else {
+            continue;   // unknown record from a newer firmware
+        }
+        apply(record);
+        applied++;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t file_size = (size_t)ftell(file);
+
+    if (good_end < file_size) {
+        // Torn tail: keep the intact prefix so appends start on a record boundary
+        log_error(0x06, "Journal tail corrupt, truncating");
+        char temp_path[sizeof(journal_path) + 4];
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", journal_path);
+        FILE* repaired = fopen(temp_path, "wb");
+        bool ok = repaired != nullptr;
+        fseek(file, 0, SEEK_SET);
+        std::vector<uint8_t> buffer(REPLAY_BUFFER_BYTES);
+        for (size_t copied = 0; ok && copied < good_end;) {
+            size_t chunk = good_end - copied < buffer.size() ? good_end - copied : buffer.size();
+            ok = fread(buffer.data(), 1, chunk, file) == chunk && fwrite(buffer.data(), 1, chunk, repaired) == chunk;
+            copied += chunk;
+        }
+        if (repaired) {
+            fclose(repaired);
+        }
+        fclose(file);
+        // rename() replaces the journal atomically; removing it first would
+        // leave a window with no journal on flash
+        ok = ok && rename(temp_path, journal_path) == 0;
+        if (!ok) {
+            log_error(0x06, "Journal repair failed");
+        }
+    } else {
+        fclose(file);
+    }
+
+    journal_bytes = good_end;
+    return applied;
+}
+
+size_t ProfileJournal::replay(const JournalApply& apply) {
+    log_entry("ProfileJournal::replay");
+    std::lock_guard<std::mutex> guard(file_lock);
+    if (journal) {
+        fclose(journal);
+        journal = nullptr;
+    }
+
+    uint32_t snapshot_sequence = 0;
+    snapshot_slots = 0;
+    loadSnapshot(apply, &snapshot_sequence);
+    if (snapshot_sequence > sequence) {
+        sequence = snapshot_sequence;
+    }
+    size_t applied = replayJournal(apply, snapshot_sequence);
+
+    log_performance("journal_replayed_records", (float)applied);
+    log_exit("ProfileJournal::replay");
+    return applied;
+}
+
+bool ProfileJournal::compact(const ProfileSource& source, int count) {
+    log_entry("ProfileJournal::compact");
+    std::lock_guard<std::mutex> guard(file_lock);
+
+    // Everything up to this sequence is in the journal file; records
+    // appended from here on stay pending until the journal restarts
+    if (!flushLocked()) {
+        log_exit("ProfileJournal::compact");
+        return false;
+    }
+    uint32_t snapshot_sequence;
+    {
+        std::lock_guard<std::mutex> pending_guard(pending_lock);
+        snapshot_sequence = sequence;
+    }
+
+    char temp_path[sizeof(snapshot_path) + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", snapshot_path);
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        log_error(0x06, "Cannot create snapshot");
+        log_exit("ProfileJournal::compact");
+        return false;
+    }
+
+    // Fix the membership up front so the header count is exact. The table
+    // may change underneath us; journal records after snapshot_sequence
+    // repair whatever this pass sees on replay
+    std::vector<uint16_t> slots;
+    slots.reserve(count);
+    for (int slot = 0; slot < count; slot++) {
+        if (source((uint16_t)slot, nullptr)) {
+            slots.push_back((uint16_t)slot);
+        }
+    }
+
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    memcpy(header, "SLSN", 4);
+    put_le16(header + 4, SNAPSHOT_VERSION);
+    put_le16(header + 6, (uint16_t)count);
+    put_le32(header + 8, (uint32_t)slots.size());
+    put_le32(header + 12, snapshot_sequence);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    uint32_t crc = crc32_update(0, header, sizeof(header));
+
+    uint8_t payload[JOURNAL_PROFILE_SIZE];
+    VoiceProfile profile;
+    for (size_t i = 0; ok && i < slots.size(); i++) {
+        source(slots[i], &profile);
+        journal_encode_profile(payload, slots[i], profile);
+        ok = fwrite(payload, 1, sizeof(payload), file) == sizeof(payload);
+        crc = crc32_update(crc, payload, sizeof(payload));
+    }
+
+    uint8_t trailer[4];
+    put_le32(trailer, crc);
+    ok = ok && fwrite(trailer, 1, sizeof(trailer), file) == sizeof(trailer) && fflush(file) == 0;
+    fclose(file);
+
+    // Atomic replace: there is always a snapshot on flash, old or new
+    ok = ok && rename(temp_path, snapshot_path) == 0;
+    if (!ok) {
+        log_error(0x06, "Snapshot write failed");
+        remove(temp_path);
+        log_exit("ProfileJournal::compact");
+        return false;
+    }
+
+    // The snapshot now covers the journal; start it over
+    if (journal) {
+        fclose(journal);
+    }
+    journal = fopen(journal_path, "wb");
+    journal_bytes = 0;
+    snapshot_slots = (uint16_t)count;
+
+    log_performance("snapshot_profiles", (float)slots.size());
+    log_exit("ProfileJournal::compact");
+    return journal != nullptr;
+}
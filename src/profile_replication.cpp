@@ -0,0 +1,610 @@
+// Profile table replication to the Feather over I2C
+#include "profile_replication.h"
+#include "error_handler.h"
+#include "i2c_schema.h"
+#include <cstring>
+
+#ifdef ESP32
+#include <Arduino.h>
+#include <esp_random.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define REPLICATION_TASK_STACK 4096
+#define REPLICATION_TASK_PRIORITY 1
+#define REPLICATION_TASK_CORE 0
+#endif
+
+// Two frames per message keep rows from straddling a frame boundary
+// wastefully; the bus budget is charged per frame sent
+#define REPL_MESSAGE_BYTES (2 * I2C_FRAME_PAYLOAD)
+
+// Replica state carried in every ACK
+enum ReplicaState : uint8_t {
+    REPLICA_FOLLOWING = 0,
+    REPLICA_LOADING = 1,        // snapshot in progress
+    REPLICA_NEEDS_SNAPSHOT = 2
+};
+
+// Message layouts, as listed in profile_replication.h
+struct DeltaBatchSchema {
+    static constexpr uint8_t command = REPL_DELTA_BATCH;
+    using Session = I2CField<uint32_t, 0>;
+    using FirstSequence = I2CField<uint32_t, Session::end>;
+    using Count = I2CField<uint8_t, FirstSequence::end>;
+    static constexpr size_t size = Count::end;
+};
+
+struct SnapshotBeginSchema {
+    static constexpr uint8_t command = REPL_SNAPSHOT_BEGIN;
+    using Session = I2CField<uint32_t, 0>;
+    using Sequence = I2CField<uint32_t, Session::end>;
+    static constexpr size_t size = Sequence::end;
+};
+
+struct SnapshotRowsSchema {
+    static constexpr uint8_t command = REPL_SNAPSHOT_ROWS;
+    using Session = I2CField<uint32_t, 0>;
+    using Count = I2CField<uint8_t, Session::end>;
+    static constexpr size_t size = Count::end;
+};
+
+struct SnapshotEndSchema {
+    static constexpr uint8_t command = REPL_SNAPSHOT_END;
+    using Session = I2CField<uint32_t, 0>;
+    using Sequence = I2CField<uint32_t, Session::end>;
+    using Rows = I2CField<uint16_t, Sequence::end>;
+    static constexpr size_t size = Rows::end;
+};
+
+struct AckSchema {
+    static constexpr uint8_t command = REPL_ACK;
+    using Session = I2CField<uint32_t, 0>;
+    using Applied = I2CField<uint32_t, Session::end>;
+    using State = I2CField<ReplicaState, Applied::end>;
+    static constexpr size_t size = State::end;
+};
+
+// Records in the tail of DELTA_BATCH and SNAPSHOT_ROWS; an add carries
+// its fields and keyword after the header
+struct RecordHeader {
+    using Type = I2CField<ProfileChangeType, 0>;
+    using Slot = I2CField<uint16_t, Type::end>;
+    static constexpr size_t size = Slot::end;
+};
+
+struct RecordAddFields {
+    using Number = I2CField<uint16_t, 0>;
+    using Timestamp = I2CField<uint32_t, Number::end>;
+    using KeywordLength = I2CField<uint8_t, Timestamp::end>;
+    static constexpr size_t size = KeywordLength::end;
+};
+
+static_assert(sizeof(ProfileChangeType) == 1, "record type is one byte on the wire");
+static_assert(REPL_MESSAGE_BYTES <= I2C_BUFFER_SIZE, "batches must fit a message");
+static_assert(DeltaBatchSchema::size + RecordHeader::size + RecordAddFields::size + KEYWORD_MAX_LENGTH - 1
+                  <= REPL_MESSAGE_BYTES, "a batch must hold the longest record");
+static_assert(i2c_wire_size(AckSchema::size) <= I2C_FRAME_MAX, "an ACK is answered in one read");
+
+static size_t record_size(const ReplicationDelta& delta) {
+    if (delta.type != PROFILE_CHANGE_ADD) {
+        return RecordHeader::size;
+    }
+    return RecordHeader::size + RecordAddFields::size + strnlen(delta.keyword, KEYWORD_MAX_LENGTH - 1);
+}
+
+static uint8_t* encode_record(uint8_t* out, const ReplicationDelta& delta) {
+    RecordHeader::Type::put(out, delta.type);
+    RecordHeader::Slot::put(out, delta.slot);
+    out += RecordHeader::size;
+    if (delta.type == PROFILE_CHANGE_ADD) {
+        size_t length = strnlen(delta.keyword, KEYWORD_MAX_LENGTH - 1);
+        RecordAddFields::Number::put(out, delta.number);
+        RecordAddFields::Timestamp::put(out, delta.timestamp);
+        RecordAddFields::KeywordLength::put(out, (uint8_t)length);
+        memcpy(out + RecordAddFields::size, delta.keyword, length);
+        out += RecordAddFields::size + length;
+    }
+    return out;
+}
+
+// nullptr when the record runs past end or is malformed
+static const uint8_t* decode_record(const uint8_t* in, const uint8_t* end, ReplicationDelta* delta) {
+    if (end - in < (ptrdiff_t)RecordHeader::size) {
+        return nullptr;
+    }
+    delta->type = RecordHeader::Type::get(in);
+    delta->slot = RecordHeader::Slot::get(in);
+    in += RecordHeader::size;
+    if (delta->type == PROFILE_CHANGE_DEACTIVATE) {
+        return in;
+    }
+    if (delta->type != PROFILE_CHANGE_ADD || end - in < (ptrdiff_t)RecordAddFields::size) {
+        return nullptr;
+    }
+    size_t length = RecordAddFields::KeywordLength::get(in);
+    if (length >= KEYWORD_MAX_LENGTH || (size_t)(end - in) < RecordAddFields::size + length) {
+        return nullptr;
+    }
+    delta->number = RecordAddFields::Number::get(in);
+    delta->timestamp = RecordAddFields::Timestamp::get(in);
+    memcpy(delta->keyword, in + RecordAddFields::size, length);
+    delta->keyword[length] = '\0';
+    return in + RecordAddFields::size + length;
+}
+
+static ReplicationDelta make_delta(ProfileChangeType type, int slot, const VoiceProfile& profile) {
+    ReplicationDelta delta = {};
+    delta.type = type;
+    delta.slot = (uint16_t)slot;
+    delta.number = profile.assignment_number;
+    delta.timestamp = profile.timestamp;
+    strncpy(delta.keyword, profile.keyword, sizeof(delta.keyword) - 1);
+    return delta;
+}
+
+// ---- AtomS3R side ----
+
+ProfileReplicator::ProfileReplicator()
+    : last_sequence(0), snapshot_needed(true), session(0), acked(0), next_send(1),
+      last_progress_ms(0), pending_since_ms(0), last_refill_ms(0), tokens(REPL_BURST_FRAMES),
+      snapshot_state(SNAPSHOT_IDLE), snapshot_sequence(0), snapshot_cursor(0), snapshot_rows(0) {
+}
+
+void ProfileReplicator::begin(uint32_t session_id) {
+    std::lock_guard<std::mutex> guard(log_lock);
+    session = session_id;
+    last_sequence = 0;
+    acked = 0;
+    next_send = 1;
+    // Whatever the Feather holds predates this session
+    snapshot_needed = true;
+    snapshot_state = SNAPSHOT_IDLE;
+}
+
+void ProfileReplicator::record(ProfileChangeType type, int slot, const VoiceProfile& profile) {
+    std::lock_guard<std::mutex> guard(log_lock);
+    if (type == PROFILE_CHANGE_RESET) {
+        snapshot_needed = true;
+        return;
+    }
+    ReplicationDelta& delta = log[++last_sequence % REPL_LOG_ENTRIES];
+    delta = make_delta(type, slot, profile);
+    delta.sequence = last_sequence;
+}
+
+uint32_t ProfileReplicator::lastSequence() {
+    std::lock_guard<std::mutex> guard(log_lock);
+    return last_sequence;
+}
+
+void ProfileReplicator::startSnapshot() {
+    snapshot_needed = false;
+    snapshot_sequence = last_sequence;
+    snapshot_state = SNAPSHOT_BEGIN;
+    snapshot_cursor = 0;
+    snapshot_rows = 0;
+    log_performance("replication_snapshot_sequence", (float)snapshot_sequence);
+}
+
+void ProfileReplicator::pollAck(uint32_t now_ms) {
+    // The bus task reads replies back; take whatever ACKs it collected
+    I2CMessage msg;
+    while (receive_message(msg)) {
+        I2CView<AckSchema> ack(msg);
+        if (!ack.valid()) {
+            continue;
+        }
+        uint32_t ack_session = ack.get<AckSchema::Session>();
+        uint32_t ack_sequence = ack.get<AckSchema::Applied>();
+        ReplicaState state = ack.get<AckSchema::State>();
+
+        std::lock_guard<std::mutex> guard(log_lock);
+        if (snapshot_state != SNAPSHOT_IDLE || state == REPLICA_LOADING) {
+            continue;
+        }
+        if (state == REPLICA_NEEDS_SNAPSHOT || ack_session != session) {
+            snapshot_needed = true;
+        } else if (ack_sequence > acked && ack_sequence <= last_sequence) {
+            acked = ack_sequence;
+            last_progress_ms = now_ms;
+            if (next_send <= acked) {
+                next_send = acked + 1;
+            }
+        }
+    }
+}
+
+size_t ProfileReplicator::sendBatch(uint32_t now_ms) {
+    I2CMessage msg = {};
+    I2CBuilder<DeltaBatchSchema> batch(msg);
+    uint8_t* out = batch.tail();
+    uint8_t* end = msg.data + REPL_MESSAGE_BYTES;
+    uint8_t count = 0;
+    uint32_t first;
+    {
+        std::lock_guard<std::mutex> guard(log_lock);
+        if (next_send > last_sequence || next_send - acked > REPL_WINDOW) {
+            return 0;
+        }
+        first = next_send;
+
+        // Hold a partial batch back until the oldest delta has waited long
+        // enough; a rush fills messages instead of sending many thin ones
+        size_t pending_bytes = DeltaBatchSchema::size;
+        for (uint32_t seq = next_send; seq <= last_sequence && pending_bytes <= REPL_MESSAGE_BYTES; seq++) {
+            pending_bytes += record_size(log[seq % REPL_LOG_ENTRIES]);
+        }
+        if (pending_bytes <= REPL_MESSAGE_BYTES && now_ms - pending_since_ms < REPL_BATCH_INTERVAL_MS) {
+            return 0;
+        }
+
+        for (uint32_t seq = next_send; seq <= last_sequence && count < UINT8_MAX && seq - acked <= REPL_WINDOW; seq++) {
+            const ReplicationDelta& delta = log[seq % REPL_LOG_ENTRIES];
+            if (out + record_size(delta) > end) {
+                break;
+            }
+            out = encode_record(out, delta);
+            count++;
+        }
+        next_send += count;
+    }
+
+    batch.set<DeltaBatchSchema::Session>(session)
+        .set<DeltaBatchSchema::FirstSequence>(first)
+        .set<DeltaBatchSchema::Count>(count)
+        .finish(out);
+    send_message(msg);
+    return i2c_fragment_count(msg);
+}
+
+size_t ProfileReplicator::sendSnapshotStep() {
+    I2CMessage msg = {};
+
+    switch (snapshot_state) {
+    case SNAPSHOT_BEGIN:
+        I2CBuilder<SnapshotBeginSchema>(msg)
+            .set<SnapshotBeginSchema::Session>(session)
+            .set<SnapshotBeginSchema::Sequence>(snapshot_sequence);
+        snapshot_state = SNAPSHOT_ROWS;
+        break;
+
+    case SNAPSHOT_ROWS: {
+        I2CBuilder<SnapshotRowsSchema> rows(msg);
+        uint8_t* out = rows.tail();
+        uint8_t* end = msg.data + REPL_MESSAGE_BYTES;
+        uint8_t count = 0;
+        int slots = profile_slot_count();
+        VoiceProfile profile;
+        while (snapshot_cursor < slots && count < UINT8_MAX) {
+            if (!load_voice_profile(snapshot_cursor, &profile) || !profile.active) {
+                snapshot_cursor++;
+                continue;
+            }
+            ReplicationDelta delta = make_delta(PROFILE_CHANGE_ADD, snapshot_cursor, profile);
+            if (out + record_size(delta) > end) {
+                break;
+            }
+            out = encode_record(out, delta);
+            count++;
+            snapshot_cursor++;
+        }
+        if (snapshot_cursor >= slots) {
+            snapshot_state = SNAPSHOT_END;
+        }
+        if (count == 0) {
+            return 0;
+        }
+        snapshot_rows += count;
+        rows.set<SnapshotRowsSchema::Session>(session).set<SnapshotRowsSchema::Count>(count).finish(out);
+        break;
+    }
+
+    case SNAPSHOT_END:
+        I2CBuilder<SnapshotEndSchema>(msg)
+            .set<SnapshotEndSchema::Session>(session)
+            .set<SnapshotEndSchema::Sequence>(snapshot_sequence)
+            .set<SnapshotEndSchema::Rows>(snapshot_rows);
+        {
+            // The replica now matches the table as of snapshot_sequence;
+            // deltas after it bring it up to date
+            std::lock_guard<std::mutex> guard(log_lock);
+            snapshot_state = SNAPSHOT_IDLE;
+            acked = snapshot_sequence;
+            next_send = snapshot_sequence + 1;
+        }
+        break;
+
+    default:
+        return 0;
+    }
+
+    send_message(msg);
+    return i2c_fragment_count(msg);
+}
+
+void ProfileReplicator::service(uint32_t now_ms) {
+    // Token bucket: at most REPL_FRAMES_PER_SECOND frames handed to the bus
+    uint32_t earned = (now_ms - last_refill_ms) * REPL_FRAMES_PER_SECOND / 1000;
+    if (earned > 0) {
+        tokens = tokens + (int32_t)earned > REPL_BURST_FRAMES ? REPL_BURST_FRAMES : tokens + (int32_t)earned;
+        last_refill_ms += earned * 1000 / REPL_FRAMES_PER_SECOND;
+    }
+
+    pollAck(now_ms);
+
+    {
+        std::lock_guard<std::mutex> guard(log_lock);
+        bool log_overrun = snapshot_state == SNAPSHOT_IDLE
+                               ? last_sequence - acked > REPL_LOG_ENTRIES
+                               : last_sequence - snapshot_sequence > REPL_LOG_ENTRIES - REPL_WINDOW;
+        if (snapshot_needed || log_overrun) {
+            startSnapshot();
+            last_progress_ms = now_ms;
+        }
+
+        if (next_send > last_sequence) {
+            pending_since_ms = now_ms;
+        }
+
+        // Nothing acknowledged for a while: go back and resend
+        if (snapshot_state == SNAPSHOT_IDLE && next_send > acked + 1 &&
+            now_ms - last_progress_ms >= REPL_ACK_TIMEOUT_MS) {
+            next_send = acked + 1;
+            last_progress_ms = now_ms;
+            log_performance("replication_resend_from", (float)next_send);
+        }
+    }
+
+    // Leave the send queue room rather than have a message refused
+    while (tokens > 0 && i2c_pending_sends() < I2C_SEND_QUEUE) {
+        size_t frames = snapshot_state != SNAPSHOT_IDLE ? sendSnapshotStep() : sendBatch(now_ms);
+        if (frames == 0 && snapshot_state == SNAPSHOT_IDLE) {
+            break;
+        }
+        tokens -= (int32_t)frames;
+    }
+}
+
+// ---- Feather side ----
+
+ProfileReplica::ProfileReplica(size_t max_slots)
+    : numbers(max_slots, 0), timestamps(max_slots, 0), keywords(max_slots * KEYWORD_MAX_LENGTH, 0),
+      active(max_slots, 0), active_count(0), session(0), applied(0), in_snapshot(false) {
+    for (size_t i = 0; i < NUMBER_ALLOCATOR_CAPACITY; i++) {
+        number_slots[i] = -1;
+    }
+}
+
+void ProfileReplica::clear() {
+    for (size_t slot = 0; slot < active.size(); slot++) {
+        active[slot] = 0;
+    }
+    for (size_t i = 0; i < NUMBER_ALLOCATOR_CAPACITY; i++) {
+        number_slots[i] = -1;
+    }
+    keyword_index.clear();
+    active_count = 0;
+}
+
+void ProfileReplica::store(const ReplicationDelta& delta) {
+    size_t slot = delta.slot;
+    if (slot >= active.size()) {
+        return;
+    }
+    char* keyword = &keywords[slot * KEYWORD_MAX_LENGTH];
+
+    // Records are keyed by slot, so replaying one twice is harmless
+    if (active[slot]) {
+        keyword_index.remove(keyword_hash(keyword), (int16_t)slot);
+        if (numbers[slot] < NUMBER_ALLOCATOR_CAPACITY && number_slots[numbers[slot]] == (int16_t)slot) {
+            number_slots[numbers[slot]] = -1;
+        }
+        active[slot] = 0;
+        active_count--;
+    }
+
+    if (delta.type == PROFILE_CHANGE_ADD && delta.number < NUMBER_ALLOCATOR_CAPACITY) {
+        memcpy(keyword, delta.keyword, KEYWORD_MAX_LENGTH);
+        numbers[slot] = delta.number;
+        timestamps[slot] = delta.timestamp;
+        active[slot] = 1;
+        active_count++;
+        number_slots[delta.number] = (int16_t)slot;
+        keyword_index.insert(keyword_hash(keyword), (int16_t)slot);
+    }
+}
+
+const uint8_t* ProfileReplica::applyRecords(const uint8_t* in, const uint8_t* end, uint8_t count,
+                                            uint32_t first_sequence) {
+    for (uint8_t i = 0; i < count && in; i++) {
+        ReplicationDelta delta = {};
+        in = decode_record(in, end, &delta);
+        if (!in) {
+            log_error(0x07, "Malformed replication record");
+            break;
+        }
+        // Snapshot rows carry no sequence; deltas apply strictly in order
+        if (first_sequence != 0) {
+            uint32_t sequence = first_sequence + i;
+            if (sequence <= applied) {
+                continue;
+            }
+            if (sequence != applied + 1) {
+                break;
+            }
+            applied = sequence;
+        }
+        store(delta);
+    }
+    return in;
+}
+
+bool ProfileReplica::apply(const I2CMessage& msg) {
+    // Frames arrive CRC-checked; only the length is left to trust, and each
+    // view checks it covers the schema's fixed fields
+    switch (msg.command) {
+    case REPL_SNAPSHOT_BEGIN: {
+        I2CView<SnapshotBeginSchema> begin(msg);
+        if (!begin.valid()) {
+            return false;
+        }
+        clear();
+        session = begin.get<SnapshotBeginSchema::Session>();
+        applied = 0;
+        in_snapshot = true;
+        return true;
+    }
+
+    case REPL_SNAPSHOT_ROWS: {
+        I2CView<SnapshotRowsSchema> rows(msg);
+        if (rows.valid() && in_snapshot && rows.get<SnapshotRowsSchema::Session>() == session) {
+            applyRecords(rows.tail(), rows.end(), rows.get<SnapshotRowsSchema::Count>(), 0);
+        }
+        return false;
+    }
+
+    case REPL_SNAPSHOT_END: {
+        I2CView<SnapshotEndSchema> end(msg);
+        if (!end.valid()) {
+            return false;
+        }
+        if (in_snapshot && end.get<SnapshotEndSchema::Session>() == session) {
+            applied = end.get<SnapshotEndSchema::Sequence>();
+            in_snapshot = false;
+            // A frame that failed its CRC took rows with it: start over
+            if (active_count != (int)end.get<SnapshotEndSchema::Rows>()) {
+                log_error(0x07, "Snapshot rows missing");
+                session = 0;
+            }
+        }
+        return true;
+    }
+
+    case REPL_DELTA_BATCH: {
+        I2CView<DeltaBatchSchema> batch(msg);
+        if (!batch.valid()) {
+            return false;
+        }
+        uint32_t message_session = batch.get<DeltaBatchSchema::Session>();
+        if (in_snapshot && message_session == session) {
+            // Deltas after a snapshot we never saw end: start over
+            in_snapshot = false;
+            session = 0;
+        } else if (message_session == session && !in_snapshot) {
+            applyRecords(batch.tail(), batch.end(), batch.get<DeltaBatchSchema::Count>(),
+                         batch.get<DeltaBatchSchema::FirstSequence>());
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void ProfileReplica::acknowledge() {
+    I2CMessage msg = {};
+    I2CBuilder<AckSchema>(msg)
+        .set<AckSchema::Session>(session)
+        .set<AckSchema::Applied>(applied)
+        .set<AckSchema::State>(in_snapshot ? REPLICA_LOADING
+                               : session == 0 ? REPLICA_NEEDS_SNAPSHOT : REPLICA_FOLLOWING);
+    send_message(msg);
+}
+
+bool ProfileReplica::lookupNumber(uint16_t number, char* keyword, size_t keyword_size, uint32_t* timestamp) const {
+    if (number >= NUMBER_ALLOCATOR_CAPACITY || number_slots[number] < 0) {
+        return false;
+    }
+    size_t slot = number_slots[number];
+    if (keyword && keyword_size > 0) {
+        strncpy(keyword, &keywords[slot * KEYWORD_MAX_LENGTH], keyword_size - 1);
+        keyword[keyword_size - 1] = '\0';
+    }
+    if (timestamp) {
+        *timestamp = timestamps[slot];
+    }
+    return true;
+}
+
+size_t ProfileReplica::findKeyword(const char* keyword, uint16_t* found, size_t max_numbers) const {
+    int16_t slots[16];
+    size_t candidates = keyword_index.find(keyword_hash(keyword), slots, sizeof(slots) / sizeof(slots[0]));
+    size_t count = 0;
+    for (size_t i = 0; i < candidates && count < max_numbers; i++) {
+        if (keyword_equal(&keywords[slots[i] * KEYWORD_MAX_LENGTH], keyword)) {
+            found[count++] = numbers[slots[i]];
+        }
+    }
+    return count;
+}
+
+// ---- Wiring ----
+
+static ProfileReplicator replicator;
+
+// Built on first use so the AtomS3R never pays for the replica's columns
+static ProfileReplica& replica_storage() {
+    static ProfileReplica instance(MAX_PROFILES);
+    return instance;
+}
+
+#ifdef ESP32
+static void replication_task(void* arg) {
+    while (true) {
+        replicator.service(millis());
+        vTaskDelay(pdMS_TO_TICKS(REPL_SERVICE_PERIOD_MS));
+    }
+}
+#endif
+
+bool replication_begin() {
+    log_entry("replication_begin");
+#ifdef ESP32
+    uint32_t session_id = esp_random() | 1;
+#else
+    uint32_t session_id = 1;
+#endif
+    replicator.begin(session_id);
+    set_profile_change_listener([](ProfileChangeType type, int slot, const VoiceProfile& profile) {
+        replicator.record(type, slot, profile);
+    });
+
+#ifdef ESP32
+    // Bus traffic stays off the guest-facing loop
+    xTaskCreatePinnedToCore(replication_task, "replication", REPLICATION_TASK_STACK, nullptr,
+                            REPLICATION_TASK_PRIORITY, nullptr, REPLICATION_TASK_CORE);
+#endif
+    log_exit("replication_begin");
+    return true;
+}
+
+void replication_service(uint32_t now_ms) {
+    replicator.service(now_ms);
+}
+
+bool replica_begin() {
+    log_entry("replica_begin");
+    bool ok = i2c_begin_peripheral();
+    // Ask for a snapshot straight away
+    replica_storage().acknowledge();
+    log_exit("replica_begin");
+    return ok;
+}
+
+void replica_service() {
+    ProfileReplica& local = replica_storage();
+    I2CMessage msg;
+    bool changed = false;
+    while (receive_message(msg)) {
+        changed = local.apply(msg) || changed;
+    }
+    if (changed) {
+        local.acknowledge();
+    }
+}
+
+const ProfileReplica& replica() {
+    return replica_storage();
+}
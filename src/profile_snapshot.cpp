@@ -0,0 +1,228 @@
+// Bulk column snapshot of the profile table
+#include "profile_snapshot.h"
+#include "crc32.h"
+#include "error_handler.h"
+#include <cstdio>
+#include <cstring>
+
+static const ProfileColumn snapshot_columns[PROFILE_COLUMN_COUNT] = {
+    COLUMN_KEYWORD_HASHES, COLUMN_VOICE_HASHES, COLUMN_NUMBERS,
+    COLUMN_ACTIVE_BITS, COLUMN_SIGNATURES, COLUMN_INVERSE_NORMS,
+    COLUMN_PITCHES, COLUMN_KEYWORDS, COLUMN_TIMESTAMPS
+};
+
+static inline void put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static inline void put_le32(uint8_t* p, uint32_t value) {
+    put_le16(p, value & 0xFFFF);
+    put_le16(p + 2, value >> 16);
+}
+
+static inline uint16_t get_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t* p) {
+    return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+static inline size_t padding(size_t length) {
+    return (4 - (length & 3)) & 3;
+}
+
+static void encode_header(uint8_t* header, uint32_t rows, uint32_t crc) {
+    memset(header, 0, PROFILE_SNAPSHOT_HEADER_SIZE);
+    memcpy(header, "SLPS", 4);
+    put_le16(header + 4, PROFILE_SNAPSHOT_VERSION);
+    put_le16(header + 6, PROFILE_SNAPSHOT_HEADER_SIZE);
+    put_le32(header + 8, rows);
+    put_le16(header + 12, PROFILE_COLUMN_COUNT);
+    put_le16(header + 14, VOICE_SIGNATURE_SIZE);
+    put_le16(header + 16, sizeof(VoiceProfile::keyword));
+    put_le32(header + 20, crc);
+}
+
+static bool decode_header(const uint8_t* header, ProfileSnapshotInfo* info) {
+    if (memcmp(header, "SLPS", 4) != 0 || get_le16(header + 6) != PROFILE_SNAPSHOT_HEADER_SIZE) {
+        log_error(0x06, "Not a profile snapshot");
+        return false;
+    }
+    info->version = get_le16(header + 4);
+    info->rows = get_le32(header + 8);
+    info->columns = get_le16(header + 12);
+    info->crc = get_le32(header + 20);
+    if (info->version != PROFILE_SNAPSHOT_VERSION) {
+        log_error(0x06, "Unsupported snapshot version");
+        return false;
+    }
+    // The column layout is only meaningful for the same row shape
+    if (get_le16(header + 14) != VOICE_SIGNATURE_SIZE || get_le16(header + 16) != sizeof(VoiceProfile::keyword)) {
+        log_error(0x06, "Snapshot row layout mismatch");
+        return false;
+    }
+    return true;
+}
+
+bool profile_snapshot_write(const char* path, ProfileTable& table, size_t rows) {
+    log_entry("profile_snapshot_write");
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error(0x06, "Cannot create snapshot");
+        log_exit("profile_snapshot_write");
+        return false;
+    }
+
+    // Header goes in last, once the checksum is known
+    uint8_t header[PROFILE_SNAPSHOT_HEADER_SIZE];
+    encode_header(header, (uint32_t)rows, 0);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint32_t crc = 0;
+    static const uint8_t zeros[4] = {0, 0, 0, 0};
+    for (size_t i = 0; ok && i < PROFILE_COLUMN_COUNT; i++) {
+        size_t length = table.columnBytes(snapshot_columns[i], rows);
+        uint8_t block[PROFILE_SNAPSHOT_BLOCK_HEADER_SIZE];
+        put_le16(block, snapshot_columns[i]);
+        put_le16(block + 2, 0);
+        put_le32(block + 4, (uint32_t)length);
+
+        const uint8_t* data = (const uint8_t*)table.columnData(snapshot_columns[i]);
+        size_t pad = padding(length);
+        crc = crc32_update(crc, block, sizeof(block));
+        crc = crc32_update(crc, data, length);
+        crc = crc32_update(crc, zeros, pad);
+        ok = fwrite(block, 1, sizeof(block), file) == sizeof(block) &&
+             fwrite(data, 1, length, file) == length &&
+             fwrite(zeros, 1, pad, file) == pad;
+    }
+
+    if (ok) {
+        encode_header(header, (uint32_t)rows, crc);
+        ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    }
+    ok = fflush(file) == 0 && ok;
+    fclose(file);
+
+    if (!ok) {
+        log_error(0x06, "Snapshot export failed");
+        remove(path);
+    } else {
+        log_performance("snapshot_export_rows", (float)rows);
+    }
+    log_exit("profile_snapshot_write");
+    return ok;
+}
+
+bool profile_snapshot_verify(const char* path, size_t capacity, ProfileSnapshotInfo* info) {
+    log_entry("profile_snapshot_verify");
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        log_error(0x06, "Cannot open snapshot");
+        log_exit("profile_snapshot_verify");
+        return false;
+    }
+
+    uint8_t header[PROFILE_SNAPSHOT_HEADER_SIZE];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) && decode_header(header, info);
+    if (ok && info->rows > capacity) {
+        log_error(0x06, "Snapshot larger than profile table");
+        ok = false;
+    }
+
+    uint32_t crc = 0;
+    uint8_t chunk[512];
+    for (uint16_t i = 0; ok && i < info->columns; i++) {
+        uint8_t block[PROFILE_SNAPSHOT_BLOCK_HEADER_SIZE];
+        ok = fread(block, 1, sizeof(block), file) == sizeof(block);
+        if (!ok) {
+            break;
+        }
+        crc = crc32_update(crc, block, sizeof(block));
+        size_t remaining = get_le32(block + 4);
+        remaining += padding(remaining);
+        while (ok && remaining > 0) {
+            size_t step = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+            ok = fread(chunk, 1, step, file) == step;
+            crc = crc32_update(crc, chunk, step);
+            remaining -= step;
+        }
+    }
+    fclose(file);
+
+    if (ok && crc != info->crc) {
+        log_error(0x06, "Snapshot checksum mismatch");
+        ok = false;
+    }
+    log_exit("profile_snapshot_verify");
+    return ok;
+}
+
+bool profile_snapshot_read(const char* path, ProfileTable& table, size_t* rows) {
+    log_entry("profile_snapshot_read");
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        log_error(0x06, "Cannot open snapshot");
+        log_exit("profile_snapshot_read");
+        return false;
+    }
+
+    uint8_t header[PROFILE_SNAPSHOT_HEADER_SIZE];
+    ProfileSnapshotInfo info;
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) && decode_header(header, &info) &&
+              info.rows <= table.capacity();
+
+    for (size_t slot = ok ? info.rows : 0; ok && slot < table.capacity(); slot++) {
+        table.clear(slot);
+    }
+
+    uint32_t loaded_columns = 0;
+    for (uint16_t i = 0; ok && i < info.columns; i++) {
+        uint8_t block[PROFILE_SNAPSHOT_BLOCK_HEADER_SIZE];
+        ok = fread(block, 1, sizeof(block), file) == sizeof(block);
+        if (!ok) {
+            break;
+        }
+        ProfileColumn column = (ProfileColumn)get_le16(block);
+        size_t length = get_le32(block + 4);
+        void* data = table.columnData(column);
+
+        if (!data) {
+            // Newer writer: skip what this build doesn't store
+            ok = fseek(file, (long)(length + padding(length)), SEEK_CUR) == 0;
+            continue;
+        }
+        if (length != table.columnBytes(column, info.rows)) {
+            log_error(0x06, "Snapshot column size mismatch");
+            ok = false;
+            break;
+        }
+        // One read per column, straight into the table
+        ok = fread(data, 1, length, file) == length && fseek(file, (long)padding(length), SEEK_CUR) == 0;
+        loaded_columns |= 1u << column;
+    }
+    fclose(file);
+
+    for (size_t i = 0; ok && i < PROFILE_COLUMN_COUNT; i++) {
+        if (!(loaded_columns & (1u << snapshot_columns[i]))) {
+            log_error(0x06, "Snapshot column missing");
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        // Bits past the last row belong to cleared slots
+        if (info.rows % 32) {
+            uint32_t* active_bits = (uint32_t*)table.columnData(COLUMN_ACTIVE_BITS);
+            active_bits[info.rows / 32] &= (1u << (info.rows % 32)) - 1;
+        }
+        *rows = info.rows;
+        log_performance("snapshot_import_rows", (float)info.rows);
+    } else {
+        log_error(0x06, "Snapshot import failed");
+    }
+    log_exit("profile_snapshot_read");
+    return ok;
+}
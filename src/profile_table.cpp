@@ -0,0 +1,164 @@
+// Structure-of-arrays storage behind storage_manager
+#include "profile_table.h"
+#include "keyword_index.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef ESP32
+#include <esp_heap_caps.h>
+#endif
+
+void* ProfileTable::allocate(size_t bytes, size_t alignment, bool allow_psram) {
+#ifdef ESP32
+    // Large cold columns live in PSRAM; everything the match scan touches
+    // is always allocated from internal RAM
+    if (allow_psram && bytes > PROFILE_PSRAM_THRESHOLD) {
+        void* column = heap_caps_aligned_alloc(alignment, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (column) {
+            return column;
+        }
+    }
+    return heap_caps_aligned_alloc(alignment, bytes, MALLOC_CAP_8BIT);
+#else
+    (void)allow_psram;
+    size_t rounded = (bytes + alignment - 1) / alignment * alignment;
+    return aligned_alloc(alignment, rounded);
+#endif
+}
+
+void ProfileTable::release(void* column) {
+#ifdef ESP32
+    heap_caps_free(column);
+#else
+    free(column);
+#endif
+}
+
+ProfileTable::ProfileTable(size_t capacity) : slots(capacity) {
+    size_t bitmap_words = (capacity + 31) / 32;
+
+    keyword_hashes = (uint32_t*)allocate(capacity * sizeof(uint32_t), 4, false);
+    voice_hashes = (uint32_t*)allocate(capacity * sizeof(uint32_t), 4, false);
+    numbers = (uint16_t*)allocate(capacity * sizeof(uint16_t), 4, false);
+    active_bits = (uint32_t*)allocate(bitmap_words * sizeof(uint32_t), 4, false);
+
+    // The hottest column in the match scan; 32 KB at 1000 slots, kept
+    // internal despite its size
+    signatures = (float*)allocate(capacity * VOICE_SIGNATURE_SIZE * sizeof(float), PROFILE_SIGNATURE_ALIGN, false);
+    inverse_norms = (float*)allocate(capacity * sizeof(float), 4, false);
+    pitches = (float*)allocate(capacity * sizeof(float), 4, false);
+
+    keywords = (char*)allocate(capacity * KEYWORD_TEXT_SIZE, 4, true);
+    timestamps = (uint32_t*)allocate(capacity * sizeof(uint32_t), 4, true);
+
+    allocated = keyword_hashes && voice_hashes && numbers && active_bits && signatures &&
+                inverse_norms && pitches && keywords && timestamps;
+    if (allocated) {
+        memset(active_bits, 0, bitmap_words * sizeof(uint32_t));
+        for (size_t slot = 0; slot < capacity; slot++) {
+            clear(slot);
+        }
+    }
+}
+
+ProfileTable::~ProfileTable() {
+    release(keyword_hashes);
+    release(voice_hashes);
+    release(numbers);
+    release(active_bits);
+    release(signatures);
+    release(inverse_norms);
+    release(pitches);
+    release(keywords);
+    release(timestamps);
+}
+
+void ProfileTable::setActive(size_t slot, bool active) {
+    uint32_t bit = 1u << (slot & 31);
+    if (active) {
+        active_bits[slot >> 5] |= bit;
+    } else {
+        active_bits[slot >> 5] &= ~bit;
+    }
+}
+
+void ProfileTable::store(size_t slot, const VoiceProfile& profile) {
+    keyword_hashes[slot] = keyword_hash(profile.keyword);
+    voice_hashes[slot] = profile.voice_hash;
+    numbers[slot] = profile.assignment_number;
+    setActive(slot, profile.active);
+
+    float* row = signatures + slot * VOICE_SIGNATURE_SIZE;
+    float norm = 0.0f;
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+        row[i] = profile.tone_signature[i];
+        norm += row[i] * row[i];
+    }
+    // Precomputed so a scan never takes a square root per candidate
+    inverse_norms[slot] = norm > 0.0f ? 1.0f / sqrtf(norm) : 0.0f;
+    pitches[slot] = profile.pitch_average;
+
+    char* text = keywords + slot * KEYWORD_TEXT_SIZE;
+    strncpy(text, profile.keyword, KEYWORD_TEXT_SIZE - 1);
+    text[KEYWORD_TEXT_SIZE - 1] = '\0';
+    timestamps[slot] = profile.timestamp;
+}
+
+void ProfileTable::load(size_t slot, VoiceProfile* profile) const {
+    memcpy(profile->keyword, keywords + slot * KEYWORD_TEXT_SIZE, KEYWORD_TEXT_SIZE);
+    profile->voice_hash = voice_hashes[slot];
+    profile->pitch_average = pitches[slot];
+    memcpy(profile->tone_signature, signatures + slot * VOICE_SIGNATURE_SIZE, sizeof(profile->tone_signature));
+    profile->assignment_number = numbers[slot];
+    profile->timestamp = timestamps[slot];
+    profile->active = isActive(slot);
+}
+
+void ProfileTable::clear(size_t slot) {
+    keyword_hashes[slot] = 0;
+    voice_hashes[slot] = 0;
+    numbers[slot] = 0;
+    setActive(slot, false);
+    memset(signatures + slot * VOICE_SIGNATURE_SIZE, 0, VOICE_SIGNATURE_SIZE * sizeof(float));
+    inverse_norms[slot] = 0.0f;
+    pitches[slot] = 0.0f;
+    keywords[slot * KEYWORD_TEXT_SIZE] = '\0';
+    timestamps[slot] = 0;
+}
+
+void* ProfileTable::columnData(ProfileColumn column) {
+    switch (column) {
+    case COLUMN_KEYWORD_HASHES: return keyword_hashes;
+    case COLUMN_VOICE_HASHES: return voice_hashes;
+    case COLUMN_NUMBERS: return numbers;
+    case COLUMN_ACTIVE_BITS: return active_bits;
+    case COLUMN_SIGNATURES: return signatures;
+    case COLUMN_INVERSE_NORMS: return inverse_norms;
+    case COLUMN_PITCHES: return pitches;
+    case COLUMN_KEYWORDS: return keywords;
+    case COLUMN_TIMESTAMPS: return timestamps;
+    }
+    return nullptr;
+}
+
+size_t ProfileTable::columnBytes(ProfileColumn column, size_t rows) const {
+    switch (column) {
+    case COLUMN_KEYWORD_HASHES:
+    case COLUMN_VOICE_HASHES:
+    case COLUMN_TIMESTAMPS:
+        return rows * sizeof(uint32_t);
+    case COLUMN_NUMBERS:
+        return rows * sizeof(uint16_t);
+    case COLUMN_ACTIVE_BITS:
+        return (rows + 31) / 32 * sizeof(uint32_t);
+    case COLUMN_SIGNATURES:
+        return rows * VOICE_SIGNATURE_SIZE * sizeof(float);
+    case COLUMN_INVERSE_NORMS:
+    case COLUMN_PITCHES:
+        return rows * sizeof(float);
+    case COLUMN_KEYWORDS:
+        return rows * KEYWORD_TEXT_SIZE;
+    }
+    return 0;
+}
@@ -1,59 +1,216 @@
 // Voice profile storage
 #include "storage_manager.h"
 #include "error_handler.h"
+#include "voice_matcher.h"
+#include "keyword_index.h"
+#include "phonetic_index.h"
+#include "profile_journal.h"
+#include "profile_table.h"
+#include "profile_snapshot.h"
+#include "number_allocator.h"
+#include "expiry_wheel.h"
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <mutex>
 
-void store_voice_profile() {
-    log_entry("store_voice_profile");
-    // ...storage logic...
-    log_exit("store_voice_profile");
+#ifdef ESP32
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define STORAGE_TASK_STACK 4096
+#define STORAGE_TASK_PRIORITY 1
+#define STORAGE_TASK_CORE 0
+#define STORAGE_SERVICE_PERIOD_MS 100
+#endif
+
+// Columnar table. Slots of inactive profiles are reused, so profile_count
+// is a high-water mark and the live rows stay packed below it
+static ProfileTable table(MAX_PROFILES);
+static int profile_count = 0;
+static int active_count = 0;
+static int16_t free_slots[MAX_PROFILES];
+static int free_slot_count = 0;
+
+// Guest calls and the storage task (expiry, compaction) share the table
+static std::recursive_mutex table_lock;
+
+// Active profiles by deadline; expiry runs in storage_service()
+static ExpiryWheel expiry_wheel(MAX_PROFILES);
+static uint32_t profile_ttl_seconds = PROFILE_TTL_SECONDS;
+static std::atomic<bool> expire_all_requested(false);
+static bool wall_clock_known = false;   // restored rows have been aged against it
+
+static ProfileChangeListener change_listener;
+
+// Numbers held by active profiles; deactivation returns them to the pool
+static NumberAllocator assignment_numbers;
+
+// Keyword hash -> table slot, holds active profiles only
+static KeywordIndex keyword_index;
+
+// Phonetic key -> slots, for keywords STT spelled differently; active only
+static PhoneticIndex phonetic_index(MAX_PROFILES);
+
+// Every change is journaled; flash writes happen in storage_service()
+static ProfileJournal journal;
+static uint32_t last_flush_ms = 0;
+
+// Lookup scratch, kept off the caller's stack at this table size
+static int16_t lookup_slots[MAX_PROFILES];
+
+static uint32_t uptime_seconds() {
+#ifdef ESP32
+    return millis() / 1000;
+#else
+    return 0;
+#endif
 }
 
-#define MAX_PROFILES 100
-struct VoiceProfile {
-    char keyword[32];
-    uint32_t voice_hash;
-    float pitch_average;
-    float tone_signature[8];
-    uint16_t assignment_number;
-    uint32_t timestamp;
-    bool active;
-};
+uint32_t profile_timestamp_now() {
+    time_t now = time(nullptr);
+    return now >= (time_t)PROFILE_EPOCH_VALID ? (uint32_t)now : 0;
+}
 
-VoiceProfile profiles[MAX_PROFILES];
-int profile_count = 0;
+// The wheel runs on uptime, which restarts every boot; timestamps are wall
+// clock. Converts a row's expiry to an uptime deadline, or a full TTL from
+// now when either side has no wall time. Already past means due now.
+static uint32_t expiry_deadline(uint32_t timestamp, uint32_t now_uptime) {
+    uint32_t wall = profile_timestamp_now();
+    if (timestamp < PROFILE_EPOCH_VALID || wall == 0) {
+        return now_uptime + profile_ttl_seconds;
+    }
+    uint32_t expires = timestamp + profile_ttl_seconds;
+    return expires <= wall ? now_uptime : now_uptime + (expires - wall);
+}
 
-// Store a new profile
-bool add_voice_profile(const VoiceProfile& profile) {
+// Store a new profile; returns its assignment number, 0 on failure
+uint16_t add_voice_profile(const VoiceProfile& profile, int zone) {
     log_entry("add_voice_profile");
-    if (profile_count >= MAX_PROFILES) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    if (!table.isAllocated() || (free_slot_count == 0 && profile_count >= MAX_PROFILES)) {
         log_error(0x03, "Storage full");
         log_exit("add_voice_profile");
-        return false;
+        return 0;
+    }
+
+    VoiceProfile stored = profile;
+    if (stored.active) {
+        if (stored.assignment_number == 0) {
+            stored.assignment_number = assignment_numbers.allocate(zone);
+        } else if (!assignment_numbers.reserve(stored.assignment_number)) {
+            stored.assignment_number = 0;
+        }
+        if (stored.assignment_number == 0) {
+            log_error(0x03, "No assignment number available");
+            log_exit("add_voice_profile");
+            return 0;
+        }
+    }
+
+    int slot = free_slot_count > 0 ? free_slots[free_slot_count - 1] : profile_count;
+    if (stored.active && !keyword_index.insert(keyword_hash(stored.keyword), (int16_t)slot)) {
+        assignment_numbers.release(stored.assignment_number);
+        log_error(0x03, "Keyword index full");
+        log_exit("add_voice_profile");
+        return 0;
+    }
+    if (slot == profile_count) {
+        profile_count++;
+    } else {
+        free_slot_count--;
+    }
+    table.store(slot, stored);
+    if (stored.active) {
+        phonetic_index.insert(stored.keyword, (int16_t)slot);
+        expiry_wheel.schedule((int16_t)slot, expiry_deadline(stored.timestamp, uptime_seconds()));
+        active_count++;
+    } else {
+        free_slots[free_slot_count++] = (int16_t)slot;
+    }
+    journal.appendAdd((uint16_t)slot, stored);
+    if (change_listener) {
+        change_listener(PROFILE_CHANGE_ADD, slot, stored);
     }
-    profiles[profile_count++] = profile;
     log_exit("add_voice_profile");
-    return true;
+    return stored.assignment_number;
+}
+
+// Active profiles registered under the keyword; returns the count. With
+// no exact hit, falls back to keywords that sound the same
+static size_t find_keyword_slots(const char* keyword, int16_t* slots, size_t max_slots) {
+    uint32_t hash = keyword_hash(keyword);
+    size_t found = keyword_index.find(hash, slots, max_slots);
+
+    // Drop hash collisions; the cold keyword text is only read when the
+    // stored hash column agrees
+    size_t count = 0;
+    for (size_t i = 0; i < found; i++) {
+        if (table.keywordHash(slots[i]) == hash && keyword_equal(table.keyword(slots[i]), keyword)) {
+            slots[count++] = slots[i];
+        }
+    }
+    if (count == 0) {
+        count = phonetic_index.find(keyword, PHONETIC_MAX_DISTANCE, slots, max_slots);
+        log_performance("keyword_fuzzy_candidates", (float)count);
+    }
+    return count;
 }
 
 // Retrieve profile by keyword and voice hash
-VoiceProfile* find_voice_profile(const char* keyword, uint32_t voice_hash) {
+int find_voice_profile(const char* keyword, uint32_t voice_hash) {
     log_entry("find_voice_profile");
-    for (int i = 0; i < profile_count; ++i) {
-        if (profiles[i].active && strcmp(profiles[i].keyword, keyword) == 0 && profiles[i].voice_hash == voice_hash) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    size_t count = find_keyword_slots(keyword, lookup_slots, MAX_PROFILES);
+    for (size_t i = 0; i < count; ++i) {
+        if (table.voiceHash(lookup_slots[i]) == voice_hash) {
             log_exit("find_voice_profile");
-            return &profiles[i];
+            return lookup_slots[i];
         }
     }
     log_exit("find_voice_profile");
-    return nullptr;
+    return -1;
+}
+
+bool load_voice_profile(int slot, VoiceProfile* profile) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    if (slot < 0 || slot >= profile_count || !profile) {
+        return false;
+    }
+    table.load(slot, profile);
+    return true;
+}
+
+uint16_t profile_assignment_number(int slot) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    return (slot >= 0 && slot < profile_count) ? table.number(slot) : 0;
+}
+
+// Takes an active slot out of every index and frees it for reuse
+static void retire_slot(int16_t slot) {
+    table.setActive(slot, false);
+    keyword_index.remove(table.keywordHash(slot), (int16_t)slot);
+    phonetic_index.remove(table.keyword(slot), (int16_t)slot);
+    assignment_numbers.release(table.number(slot));
+    expiry_wheel.cancel(slot);
+    free_slots[free_slot_count++] = slot;
+    active_count--;
+    journal.appendDeactivate((uint16_t)slot);
+    if (change_listener) {
+        VoiceProfile profile;
+        table.load(slot, &profile);
+        change_listener(PROFILE_CHANGE_DEACTIVATE, slot, profile);
+    }
 }
 
 // Mark profile as inactive (item retrieved)
 bool deactivate_profile(const char* keyword, uint32_t voice_hash) {
     log_entry("deactivate_profile");
-    VoiceProfile* profile = find_voice_profile(keyword, voice_hash);
-    if (profile) {
-        profile->active = false;
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    int slot = find_voice_profile(keyword, voice_hash);
+    if (slot >= 0) {
+        retire_slot((int16_t)slot);
         log_exit("deactivate_profile");
         return true;
     }
@@ -61,3 +218,245 @@ bool deactivate_profile(const char* keyword, uint32_t voice_hash) {
     log_exit("deactivate_profile");
     return false;
 }
+
+bool deactivate_profile_slot(int slot) {
+    log_entry("deactivate_profile_slot");
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    if (slot < 0 || slot >= profile_count || !table.isActive(slot)) {
+        log_error(0x03, "Profile not active");
+        log_exit("deactivate_profile_slot");
+        return false;
+    }
+    retire_slot((int16_t)slot);
+    log_exit("deactivate_profile_slot");
+    return true;
+}
+
+int active_profile_count() {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    return active_count;
+}
+
+int assignment_numbers_available() {
+    return (int)assignment_numbers.available();
+}
+
+void set_assignment_policy(NumberPolicy policy) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    assignment_numbers.setPolicy(policy);
+}
+
+void set_profile_change_listener(const ProfileChangeListener& listener) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    change_listener = listener;
+}
+
+int profile_slot_count() {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    return profile_count;
+}
+
+// Applies to profiles stored from now on
+void set_profile_ttl(uint32_t seconds) {
+    profile_ttl_seconds = seconds;
+}
+
+void expire_all_profiles() {
+    expire_all_requested = true;
+}
+
+// Score every active profile registered under the keyword in one batch
+int match_voice_profile(const char* keyword, const VoiceFeatures& features, float* confidence) {
+    log_entry("match_voice_profile");
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    size_t count = find_keyword_slots(keyword, lookup_slots, MAX_PROFILES);
+
+    VoiceMatchResult result = voice_match_rows(features, table.matrix(), lookup_slots, count);
+    if (confidence) {
+        *confidence = result.confidence;
+    }
+    log_exit("match_voice_profile");
+    return result.index >= 0 ? lookup_slots[result.index] : -1;
+}
+
+// Replay target: puts the slot's row into exactly the recorded state;
+// rebuild_state() derives the indexes once replay is done
+static void restore_slot(const JournalRecord& record) {
+    if (record.slot >= MAX_PROFILES || !table.isAllocated()) {
+        return;
+    }
+
+    if (record.type == JOURNAL_ADD) {
+        table.store(record.slot, record.profile);
+    } else {
+        table.setActive(record.slot, false);
+    }
+    if (record.slot >= profile_count) {
+        profile_count = record.slot + 1;
+    }
+}
+
+// Empties the table and everything derived from it
+static void reset_state() {
+    for (int slot = 0; slot < profile_count; slot++) {
+        table.clear(slot);
+    }
+    profile_count = 0;
+    active_count = 0;
+    free_slot_count = 0;
+    keyword_index.clear();
+    phonetic_index.clear();
+    assignment_numbers.reset();
+    expiry_wheel.clear();
+}
+
+// Indexes, number pool, expiry and free list from the rows below profile_count.
+// Rows are aged against the wall clock when it is set; last night's guests
+// expire on the first tick instead of getting another shift
+static void rebuild_state(uint32_t now_seconds) {
+    active_count = 0;
+    free_slot_count = 0;
+    wall_clock_known = profile_timestamp_now() != 0;
+    expiry_wheel.start(now_seconds);
+    for (int slot = profile_count - 1; slot >= 0; slot--) {
+        if (table.isActive(slot) && !assignment_numbers.reserve(table.number(slot))) {
+            // Two rows claiming one number: the higher slot keeps it
+            log_error(0x03, "Duplicate assignment number");
+            table.setActive(slot, false);
+        }
+        if (table.isActive(slot)) {
+            keyword_index.insert(table.keywordHash(slot), (int16_t)slot);
+            phonetic_index.insert(table.keyword(slot), (int16_t)slot);
+            expiry_wheel.schedule((int16_t)slot, expiry_deadline(table.timestamp(slot), now_seconds));
+            active_count++;
+        } else {
+            free_slots[free_slot_count++] = (int16_t)slot;
+        }
+    }
+}
+
+// NTP set the clock after the rows were restored: re-age the ones that
+// carry a wall-clock timestamp. Rows stamped before the clock was set
+// keep their deadline from boot
+static void age_restored_rows(uint32_t now_seconds) {
+    wall_clock_known = true;
+    for (int slot = 0; slot < profile_count; slot++) {
+        if (table.isActive(slot) && table.timestamp(slot) >= PROFILE_EPOCH_VALID) {
+            expiry_wheel.schedule((int16_t)slot, expiry_deadline(table.timestamp(slot), now_seconds));
+        }
+    }
+}
+
+// Compaction source: reads rows straight out of the table
+static bool snapshot_source(uint16_t slot, VoiceProfile* profile) {
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    if (profile) {
+        table.load(slot, profile);
+    }
+    return table.isActive(slot);
+}
+
+#ifdef ESP32
+static void storage_task(void* arg) {
+    while (true) {
+        storage_service(millis());
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_SERVICE_PERIOD_MS));
+    }
+}
+#endif
+
+bool storage_begin() {
+    log_entry("storage_begin");
+    journal.open();
+    journal.replay(restore_slot);
+    if (journal.snapshotSlots() > profile_count) {
+        profile_count = journal.snapshotSlots();
+    }
+    rebuild_state(uptime_seconds());
+    log_performance("profiles_restored", (float)active_count);
+
+#ifdef ESP32
+    // Flash writes and compaction stay off the guest-facing loop
+    xTaskCreatePinnedToCore(storage_task, "storage", STORAGE_TASK_STACK, nullptr,
+                            STORAGE_TASK_PRIORITY, nullptr, STORAGE_TASK_CORE);
+#endif
+    log_exit("storage_begin");
+    return true;
+}
+
+bool export_profiles(const char* path) {
+    log_entry("export_profiles");
+    std::lock_guard<std::recursive_mutex> guard(table_lock);
+    bool ok = table.isAllocated() && profile_snapshot_write(path, table, profile_count);
+    log_exit("export_profiles");
+    return ok;
+}
+
+int import_profiles(const char* path) {
+    log_entry("import_profiles");
+    ProfileSnapshotInfo info;
+    // Checked in full first, so a bad file never touches the live table
+    if (!table.isAllocated() || !profile_snapshot_verify(path, MAX_PROFILES, &info)) {
+        log_exit("import_profiles");
+        return -1;
+    }
+
+    int restored;
+    {
+        std::lock_guard<std::recursive_mutex> guard(table_lock);
+        reset_state();
+        size_t rows = 0;
+        if (!profile_snapshot_read(path, table, &rows)) {
+            // Read failed after verification; the table is left empty
+            reset_state();
+            log_exit("import_profiles");
+            return -1;
+        }
+        profile_count = (int)rows;
+        rebuild_state(uptime_seconds());
+        restored = active_count;
+        if (change_listener) {
+            VoiceProfile empty = {};
+            change_listener(PROFILE_CHANGE_RESET, -1, empty);
+        }
+    }
+
+    // Persist the imported table as the new journal baseline. Outside the
+    // table lock: compaction takes the journal's file lock first
+    journal.compact(snapshot_source, profile_slot_count());
+    log_performance("profiles_imported", (float)restored);
+    log_exit("import_profiles");
+    return restored;
+}
+
+// Forces every pending journal record to flash
+void store_voice_profile() {
+    log_entry("store_voice_profile");
+    journal.flush();
+    log_exit("store_voice_profile");
+}
+
+void storage_service(uint32_t now_ms) {
+    size_t expired;
+    bool bulk = expire_all_requested.exchange(false);
+    {
+        std::lock_guard<std::recursive_mutex> guard(table_lock);
+        if (!wall_clock_known && profile_timestamp_now() != 0) {
+            age_restored_rows(now_ms / 1000);
+        }
+        expired = bulk ? expiry_wheel.expireAll(retire_slot) : expiry_wheel.advance(now_ms / 1000, retire_slot);
+    }
+    if (expired > 0) {
+        log_performance("profiles_expired", (float)expired);
+    }
+
+    size_t pending = journal.pendingBytes();
+    if (pending >= JOURNAL_BATCH_BYTES || (pending > 0 && now_ms - last_flush_ms >= JOURNAL_FLUSH_INTERVAL_MS)) {
+        journal.flush();
+        last_flush_ms = now_ms;
+    }
+    // After a bulk expiry the journal is mostly dead records; snapshot now
+    if (journal.compactDue() || (bulk && expired > 0)) {
+        journal.compact(snapshot_source, profile_slot_count());
+    }
+}
@@ -0,0 +1,113 @@
+// Simulated I2C link for host builds
+#include "virtual_i2c_bus.h"
+
+#ifndef ESP32
+
+#include "i2c_communication.h"
+
+VirtualI2CConfig virtual_i2c_default_config() {
+    VirtualI2CConfig config = {};
+    config.clock_hz = I2C_BUS_FREQUENCY;
+    config.stretch_us = 0;
+    config.stretch_jitter_us = 0;
+    config.timeout_us = 50000;      // Wire's default on the ESP32 core
+    config.nack_rate = 0.0;
+    config.bit_error_rate = 0.0;
+    config.seed = 1;
+    return config;
+}
+
+VirtualI2CBus::VirtualI2CBus(const VirtualI2CConfig& config)
+    : settings(config), target(), counters(), now_us(0), random(config.seed) {
+}
+
+void VirtualI2CBus::attach(const VirtualI2CPeripheral& peripheral) {
+    target = peripheral;
+}
+
+void VirtualI2CBus::advanceTo(uint64_t us) {
+    if (us > now_us) {
+        now_us = us;
+    }
+}
+
+bool VirtualI2CBus::chance(double rate) {
+    return rate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random) < rate;
+}
+
+// Start, address byte, data bytes, stop
+void VirtualI2CBus::clock(size_t bytes) {
+    uint64_t clocks = VIRTUAL_I2C_START_STOP_CLOCKS + (1 + bytes) * VIRTUAL_I2C_CLOCKS_PER_BYTE;
+    uint64_t us = (clocks * 1000000 + settings.clock_hz - 1) / settings.clock_hz;
+    now_us += us;
+    counters.busy_us += us;
+    counters.bytes += bytes;
+}
+
+// Flips bits independently; the gap to the next flip is geometric, so a
+// clean link costs nothing per bit
+void VirtualI2CBus::corrupt(uint8_t* data, size_t size) {
+    if (settings.bit_error_rate <= 0.0) {
+        return;
+    }
+    std::geometric_distribution<uint64_t> gap(settings.bit_error_rate);
+    for (uint64_t bit = gap(random); bit < size * 8; bit += 1 + gap(random)) {
+        data[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        counters.bits_flipped++;
+    }
+}
+
+bool VirtualI2CBus::write(const uint8_t* data, size_t size) {
+    counters.writes++;
+    if (chance(settings.nack_rate) || !target.on_receive) {
+        // Address NACK: start, address, stop
+        clock(0);
+        counters.nacks++;
+        return false;
+    }
+    clock(size);
+    uint8_t received[I2C_FRAME_MAX];
+    size_t used = size < sizeof(received) ? size : sizeof(received);
+    for (size_t i = 0; i < used; i++) {
+        received[i] = data[i];
+    }
+    corrupt(received, used);
+    target.on_receive(received, used);
+    return true;
+}
+
+size_t VirtualI2CBus::read(uint8_t* data, size_t size) {
+    counters.reads++;
+    if (chance(settings.nack_rate) || !target.on_request) {
+        clock(0);
+        counters.nacks++;
+        return 0;
+    }
+
+    uint64_t stretch = settings.stretch_us;
+    if (settings.stretch_jitter_us > 0) {
+        stretch += std::uniform_int_distribution<uint32_t>(0, settings.stretch_jitter_us)(random);
+    }
+    if (stretch > settings.timeout_us) {
+        now_us += settings.timeout_us;
+        counters.busy_us += settings.timeout_us;
+        counters.timeouts++;
+        return 0;
+    }
+    now_us += stretch;
+    counters.busy_us += stretch;
+
+    // The controller clocks out as many bytes as it asked for, whatever the
+    // peripheral had ready
+    uint8_t reply[I2C_FRAME_MAX] = {};
+    target.on_request(reply);
+    size_t used = size < sizeof(reply) ? size : sizeof(reply);
+    clock(used);
+    corrupt(reply, used);
+    for (size_t i = 0; i < used; i++) {
+        data[i] = reply[i];
+    }
+    return used;
+}
+
+#endif // ESP32
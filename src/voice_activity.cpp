@@ -0,0 +1,144 @@
+// Energy/zero-crossing voice activity detection for recording endpointing
+#include "voice_activity.h"
+#include "audio_dsp.h"
+
+VadConfig vad_default_config() {
+    VadConfig config;
+    config.frame_samples = VAD_FRAME_SAMPLES;
+    config.energy_ratio_q4 = 48;     // 3x the noise floor (~4.8 dB)
+    config.min_energy = 40000;       // ~200 RMS after capture gain
+    config.zcr_max = 120;            // 6 kHz equivalent on a 20 ms frame
+    config.start_frames = 3;         // 60 ms of speech to trigger
+    config.hangover_frames = 30;     // 600 ms of silence ends the utterance
+    config.pre_roll_frames = 10;     // keep 200 ms before onset
+    config.tail_frames = 8;          // keep 160 ms after the last word
+    config.noise_adapt_shift = 4;
+    return config;
+}
+
+VoiceActivityDetector::VoiceActivityDetector(const VadConfig& config) : config(config) {
+    reset();
+}
+
+void VoiceActivityDetector::reset() {
+    state = VAD_WAITING;
+    noise_floor = 0;
+    noise_initialized = false;
+    last_energy = 0;
+    last_zcr = 0;
+    speech_run = 0;
+    silence_run = 0;
+    total_samples = 0;
+    onset_sample = 0;
+    last_speech_end = 0;
+}
+
+void VoiceActivityDetector::setConfig(const VadConfig& new_config) {
+    config = new_config;
+    reset();
+}
+
+VadState VoiceActivityDetector::processFrame(const int16_t* frame, size_t samples) {
+    if (samples == 0) {
+        return state;
+    }
+
+    // Mean-square energy and zero-crossing count for this frame
+    uint32_t energy = (uint32_t)(dsp_sum_squares(frame, samples) / (int64_t)samples);
+    uint16_t crossings = 0;
+    for (size_t i = 1; i < samples; i++) {
+        crossings += ((frame[i - 1] ^ frame[i]) < 0);
+    }
+    last_energy = energy;
+    last_zcr = crossings;
+
+    size_t frame_start = total_samples;
+    total_samples += samples;
+
+    if (state == VAD_ENDED) {
+        return state;
+    }
+
+    bool speech = noise_initialized && isSpeechFrame(energy, crossings);
+    if (!speech) {
+        adaptNoiseFloor(energy);
+    }
+
+    switch (state) {
+        case VAD_WAITING:
+            if (speech) {
+                if (speech_run == 0) {
+                    onset_sample = frame_start;
+                }
+                speech_run++;
+                if (speech_run >= config.start_frames) {
+                    state = VAD_SPEECH;
+                    last_speech_end = total_samples;
+                }
+            } else {
+                speech_run = 0;
+            }
+            break;
+
+        case VAD_SPEECH:
+        case VAD_HANGOVER:
+            if (speech) {
+                state = VAD_SPEECH;
+                silence_run = 0;
+                last_speech_end = total_samples;
+            } else {
+                state = VAD_HANGOVER;
+                silence_run++;
+                if (silence_run >= config.hangover_frames) {
+                    state = VAD_ENDED;
+                }
+            }
+            break;
+
+        case VAD_ENDED:
+            break;
+    }
+
+    return state;
+}
+
+size_t VoiceActivityDetector::speechStartSample() const {
+    size_t pre_roll = (size_t)config.pre_roll_frames * config.frame_samples;
+    return onset_sample > pre_roll ? onset_sample - pre_roll : 0;
+}
+
+size_t VoiceActivityDetector::speechEndSample() const {
+    size_t end = last_speech_end + (size_t)config.tail_frames * config.frame_samples;
+    return end < total_samples ? end : total_samples;
+}
+
+bool VoiceActivityDetector::isSpeechFrame(uint32_t energy, uint16_t zcr) const {
+    uint64_t threshold = ((uint64_t)noise_floor * config.energy_ratio_q4) >> 4;
+    if (threshold < config.min_energy) {
+        threshold = config.min_energy;
+    }
+    if (energy <= threshold) {
+        return false;
+    }
+
+    // High crossing rates are hiss unless the frame is clearly loud (fricatives)
+    if (zcr > config.zcr_max && energy < threshold * 4) {
+        return false;
+    }
+    return true;
+}
+
+void VoiceActivityDetector::adaptNoiseFloor(uint32_t energy) {
+    if (!noise_initialized) {
+        noise_floor = energy;
+        noise_initialized = true;
+        return;
+    }
+
+    // Follow drops quickly and rises slowly so speech never drags the floor up
+    if (energy < noise_floor) {
+        noise_floor -= (noise_floor - energy) >> 1;
+    } else {
+        noise_floor += (energy - noise_floor) >> config.noise_adapt_shift;
+    }
+}
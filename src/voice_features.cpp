@@ -0,0 +1,301 @@
+// Frame-based MFCC extraction for VoiceProfile::tone_signature
+#include "voice_features.h"
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double LN2 = 0.69314718055994530942;
+constexpr int FFT_HALF = FEATURE_FFT_SIZE / 2;
+constexpr int SPECTRUM_BINS = FEATURE_FFT_SIZE / 2 + 1;
+constexpr int16_t PRE_EMPHASIS_Q15 = 31785; // 0.97
+constexpr float LOG_FLOOR = 1.0f;           // ~1 LSB^2 of FFT rounding noise per band
+
+// Compile-time math; only used to build the tables below
+constexpr double ct_sin(double x) {
+    while (x > PI) x -= 2.0 * PI;
+    while (x < -PI) x += 2.0 * PI;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 14; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double ct_cos(double x) {
+    return ct_sin(x + PI / 2.0);
+}
+
+constexpr double ct_ln(double x) {
+    int exponent = 0;
+    while (x >= 2.0) { x /= 2.0; exponent++; }
+    while (x < 1.0) { x *= 2.0; exponent--; }
+    double y = (x - 1.0) / (x + 1.0);
+    double term = y;
+    double sum = 0.0;
+    for (int n = 0; n < 40; n++) {
+        sum += term / (2.0 * n + 1.0);
+        term *= y * y;
+    }
+    return exponent * LN2 + 2.0 * sum;
+}
+
+constexpr int16_t to_q15(double value) {
+    double scaled = value * 32768.0;
+    scaled += scaled >= 0.0 ? 0.5 : -0.5;
+    return scaled >= 32767.0 ? 32767 : (scaled <= -32768.0 ? -32768 : (int16_t)scaled);
+}
+
+constexpr double hz_to_mel(double hz) {
+    return 1127.0 * ct_ln(1.0 + hz / 700.0);
+}
+
+constexpr std::array<int16_t, FEATURE_FRAME_SAMPLES> make_hann_window() {
+    std::array<int16_t, FEATURE_FRAME_SAMPLES> table{};
+    for (int n = 0; n < FEATURE_FRAME_SAMPLES; n++) {
+        table[n] = to_q15(0.5 - 0.5 * ct_cos(2.0 * PI * n / FEATURE_FRAME_SAMPLES));
+    }
+    return table;
+}
+
+// W_N^k = cos - j sin for the full 512-point transform; the 256-point
+// complex core uses every other entry
+struct TwiddleTable {
+    std::array<int16_t, FFT_HALF> cos_q15;
+    std::array<int16_t, FFT_HALF> sin_q15;
+};
+
+constexpr TwiddleTable make_twiddles() {
+    TwiddleTable table{};
+    for (int k = 0; k < FFT_HALF; k++) {
+        double angle = 2.0 * PI * k / FEATURE_FFT_SIZE;
+        table.cos_q15[k] = to_q15(ct_cos(angle));
+        table.sin_q15[k] = to_q15(ct_sin(angle));
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, FFT_HALF> make_bit_reverse() {
+    std::array<uint8_t, FFT_HALF> table{};
+    for (int i = 0; i < FFT_HALF; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            reversed |= ((i >> bit) & 1) << (7 - bit);
+        }
+        table[i] = (uint8_t)reversed;
+    }
+    return table;
+}
+
+// Each spectrum bin sits between two adjacent mel points: it feeds the
+// rising edge of filter `upper` with weight w and the falling edge of
+// filter `upper - 1` with weight 1 - w
+struct MelTable {
+    std::array<uint8_t, SPECTRUM_BINS> upper;
+    std::array<int16_t, SPECTRUM_BINS> weight_q15;
+};
+
+constexpr MelTable make_mel_table() {
+    MelTable table{};
+    const double mel_high = hz_to_mel(8000.0);
+    const double mel_step = mel_high / (FEATURE_MEL_BANDS + 1);
+    for (int k = 0; k < SPECTRUM_BINS; k++) {
+        double hz = k * 16000.0 / FEATURE_FFT_SIZE;
+        double position = hz_to_mel(hz) / mel_step;
+        int point = (int)position;
+        if (point > FEATURE_MEL_BANDS + 1) point = FEATURE_MEL_BANDS + 1;
+        table.upper[k] = (uint8_t)point;
+        table.weight_q15[k] = to_q15(position - point);
+    }
+    return table;
+}
+
+struct DctTable {
+    float basis[VOICE_SIGNATURE_SIZE + 1][FEATURE_MEL_BANDS];
+};
+
+constexpr DctTable make_dct() {
+    DctTable table{};
+    for (int k = 0; k <= VOICE_SIGNATURE_SIZE; k++) {
+        for (int m = 0; m < FEATURE_MEL_BANDS; m++) {
+            table.basis[k][m] = (float)ct_cos(PI * k * (m + 0.5) / FEATURE_MEL_BANDS);
+        }
+    }
+    return table;
+}
+
+constexpr auto hann_window = make_hann_window();
+constexpr auto twiddles = make_twiddles();
+constexpr auto bit_reverse = make_bit_reverse();
+constexpr auto mel_table = make_mel_table();
+constexpr auto dct_table = make_dct();
+
+inline int16_t saturate16(int32_t value) {
+    return (int16_t)(value < -32768 ? -32768 : (value > 32767 ? 32767 : value));
+}
+
+// In-place 256-point radix-2 DIT FFT in Q15, halving at every stage
+void fft_q15(int16_t* re, int16_t* im) {
+    for (int i = 0; i < FFT_HALF; i++) {
+        int j = bit_reverse[i];
+        if (j > i) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (int len = 2; len <= FFT_HALF; len <<= 1) {
+        const int half = len >> 1;
+        const int stride = FEATURE_FFT_SIZE / len;
+        for (int start = 0; start < FFT_HALF; start += len) {
+            for (int j = 0; j < half; j++) {
+                const int32_t wr = twiddles.cos_q15[j * stride];
+                const int32_t wi = -twiddles.sin_q15[j * stride];
+                const int a = start + j;
+                const int b = a + half;
+                int32_t tr = ((int32_t)re[b] * wr - (int32_t)im[b] * wi + (1 << 14)) >> 15;
+                int32_t ti = ((int32_t)re[b] * wi + (int32_t)im[b] * wr + (1 << 14)) >> 15;
+                int32_t ar = re[a];
+                int32_t ai = im[a];
+                // Rounded halving; plain shifts would bias every bin towards -1
+                re[a] = saturate16((ar + tr + 1) >> 1);
+                im[a] = saturate16((ai + ti + 1) >> 1);
+                re[b] = saturate16((ar - tr + 1) >> 1);
+                im[b] = saturate16((ai - ti + 1) >> 1);
+            }
+        }
+    }
+}
+
+} // namespace
+
+VoiceFeatureExtractor::VoiceFeatureExtractor() {
+    reset();
+}
+
+void VoiceFeatureExtractor::reset() {
+    fill = 0;
+    previous_sample = 0;
+    frames = 0;
+    memset(cepstrum_sum, 0, sizeof(cepstrum_sum));
+    memset(cepstrum, 0, sizeof(cepstrum));
+}
+
+void VoiceFeatureExtractor::pushSamples(const int16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t emphasized = (int32_t)samples[i] - (((int32_t)previous_sample * PRE_EMPHASIS_Q15 + (1 << 14)) >> 15);
+        previous_sample = samples[i];
+        window[fill++] = saturate16(emphasized);
+
+        if (fill == FEATURE_FRAME_SAMPLES) {
+            analyzeFrame();
+            memmove(window, window + FEATURE_HOP_SAMPLES,
+                    (FEATURE_FRAME_SAMPLES - FEATURE_HOP_SAMPLES) * sizeof(int16_t));
+            fill = FEATURE_FRAME_SAMPLES - FEATURE_HOP_SAMPLES;
+        }
+    }
+}
+
+bool VoiceFeatureExtractor::getSignature(float tone_signature[VOICE_SIGNATURE_SIZE]) const {
+    if (frames == 0) {
+        return false;
+    }
+    for (int k = 0; k < VOICE_SIGNATURE_SIZE; k++) {
+        tone_signature[k] = cepstrum_sum[k] / (float)frames;
+    }
+    return true;
+}
+
+void VoiceFeatureExtractor::analyzeFrame() {
+    // Window and pack the zero-padded real frame as z[n] = x[2n] + j x[2n+1]
+    int32_t peak = 0;
+    for (int n = 0; n < FFT_HALF; n++) {
+        int even = 2 * n;
+        int odd = even + 1;
+        fft_re[n] = even < FEATURE_FRAME_SAMPLES
+            ? (int16_t)(((int32_t)window[even] * hann_window[even] + (1 << 14)) >> 15) : 0;
+        fft_im[n] = odd < FEATURE_FRAME_SAMPLES
+            ? (int16_t)(((int32_t)window[odd] * hann_window[odd] + (1 << 14)) >> 15) : 0;
+        int32_t re_mag = fft_re[n] < 0 ? -fft_re[n] : fft_re[n];
+        int32_t im_mag = fft_im[n] < 0 ? -fft_im[n] : fft_im[n];
+        peak = re_mag > peak ? re_mag : peak;
+        peak = im_mag > peak ? im_mag : peak;
+    }
+
+    // Block floating point: use the full Q15 range so the per-stage halving
+    // does not bury quiet frames in rounding noise
+    int headroom = 0;
+    while (peak > 0 && (peak << (headroom + 1)) < 16384) {
+        headroom++;
+    }
+    if (headroom > 0) {
+        for (int n = 0; n < FFT_HALF; n++) {
+            fft_re[n] = (int16_t)(fft_re[n] << headroom);
+            fft_im[n] = (int16_t)(fft_im[n] << headroom);
+        }
+    }
+    const float log_scale = -2.0f * headroom * (float)LN2;
+
+    fft_q15(fft_re, fft_im);
+
+    memset(mel_energy, 0, sizeof(mel_energy));
+
+    // Split the half-length complex transform into the real spectrum
+    for (int k = 0; k < SPECTRUM_BINS; k++) {
+        const int k1 = k % FFT_HALF;
+        const int k2 = (FFT_HALF - k) % FFT_HALF;
+        const int32_t zr1 = fft_re[k1], zi1 = fft_im[k1];
+        const int32_t zr2 = fft_re[k2], zi2 = fft_im[k2];
+
+        const int32_t even_r = (zr1 + zr2) >> 1;
+        const int32_t even_i = (zi1 - zi2) >> 1;
+        const int32_t odd_r = (zi1 + zi2) >> 1;
+        const int32_t odd_i = (zr2 - zr1) >> 1;
+
+        int32_t xr;
+        int32_t xi;
+        if (k == FFT_HALF) {
+            // W^(N/2) = -1
+            xr = even_r - odd_r;
+            xi = even_i - odd_i;
+        } else {
+            const int32_t wr = twiddles.cos_q15[k];
+            const int32_t wi = -twiddles.sin_q15[k];
+            xr = even_r + ((odd_r * wr - odd_i * wi) >> 15);
+            xi = even_i + ((odd_r * wi + odd_i * wr) >> 15);
+        }
+
+        const float power = (float)xr * (float)xr + (float)xi * (float)xi;
+        const int upper = mel_table.upper[k];
+        const float weight = mel_table.weight_q15[k] * (1.0f / 32768.0f);
+        if (upper < FEATURE_MEL_BANDS) {
+            mel_energy[upper] += power * weight;
+        }
+        if (upper >= 1 && upper <= FEATURE_MEL_BANDS) {
+            mel_energy[upper - 1] += power * (1.0f - weight);
+        }
+    }
+
+    // The floor is applied before undoing the block scaling, so bands below
+    // the transform's own rounding noise clamp instead of feeding it into the DCT
+    for (int m = 0; m < FEATURE_MEL_BANDS; m++) {
+        mel_energy[m] = logf(mel_energy[m] + LOG_FLOOR) + log_scale;
+    }
+
+    for (int k = 0; k <= VOICE_SIGNATURE_SIZE; k++) {
+        float sum = 0.0f;
+        for (int m = 0; m < FEATURE_MEL_BANDS; m++) {
+            sum += dct_table.basis[k][m] * mel_energy[m];
+        }
+        cepstrum[k] = sum;
+    }
+
+    for (int k = 0; k < VOICE_SIGNATURE_SIZE; k++) {
+        cepstrum_sum[k] += cepstrum[k + 1];
+    }
+    frames++;
+}
@@ -0,0 +1,118 @@
+// Similarity scoring of voice biometrics against stored profiles
+#include "voice_matcher.h"
+#include <cmath>
+
+#define SIGNATURE_WEIGHT 0.75f
+#define PITCH_WEIGHT (1.0f - SIGNATURE_WEIGHT)
+#define PITCH_TOLERANCE_SEMITONES 6.0f  // pitch score reaches 0 at half an octave
+
+static float match_threshold = MATCH_THRESHOLD;
+
+void set_match_threshold(float threshold) {
+    if (threshold < MATCH_THRESHOLD_MIN) threshold = MATCH_THRESHOLD_MIN;
+    if (threshold > MATCH_THRESHOLD_MAX) threshold = MATCH_THRESHOLD_MAX;
+    match_threshold = threshold;
+}
+
+float get_match_threshold() {
+    return match_threshold;
+}
+
+// Fixed-length loops so the compiler fully unrolls and vectorizes them
+static inline float signature_dot(const float* a, const float* b) {
+    float sum = 0.0f;
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static inline float combine_scores(float cosine, float probe_pitch, float candidate_pitch) {
+    float signature_score = cosine > 0.0f ? cosine : 0.0f;
+
+    // Without a voiced estimate on both sides, rely on the signature alone
+    if (probe_pitch <= 0.0f || candidate_pitch <= 0.0f) {
+        return signature_score;
+    }
+
+    float semitones = 12.0f * fabsf(log2f(probe_pitch / candidate_pitch));
+    float pitch_score = 1.0f - semitones / PITCH_TOLERANCE_SEMITONES;
+    if (pitch_score < 0.0f) pitch_score = 0.0f;
+
+    return SIGNATURE_WEIGHT * signature_score + PITCH_WEIGHT * pitch_score;
+}
+
+float voice_match_score(const VoiceFeatures& probe, const float* tone_signature, float pitch_average) {
+    float probe_norm = signature_dot(probe.tone_signature, probe.tone_signature);
+    float candidate_norm = signature_dot(tone_signature, tone_signature);
+    if (probe_norm <= 0.0f || candidate_norm <= 0.0f) {
+        return 0.0f;
+    }
+
+    float cosine = signature_dot(probe.tone_signature, tone_signature) / sqrtf(probe_norm * candidate_norm);
+    return combine_scores(cosine, probe.pitch_average, pitch_average);
+}
+
+VoiceMatchResult voice_match_best(const VoiceFeatures& probe, const VoiceProfile* const* candidates,
+                                  size_t count, float* scores) {
+    VoiceMatchResult result = {-1, 0.0f};
+
+    // The probe norm is shared by every candidate, so compute it once
+    float probe_norm = signature_dot(probe.tone_signature, probe.tone_signature);
+    float inverse_probe = probe_norm > 0.0f ? 1.0f / sqrtf(probe_norm) : 0.0f;
+    int best = -1;
+
+    for (size_t i = 0; i < count; i++) {
+        const float* signature = candidates[i]->tone_signature;
+        float candidate_norm = signature_dot(signature, signature);
+        float score = 0.0f;
+        if (inverse_probe > 0.0f && candidate_norm > 0.0f) {
+            float cosine = signature_dot(probe.tone_signature, signature) * inverse_probe / sqrtf(candidate_norm);
+            score = combine_scores(cosine, probe.pitch_average, candidates[i]->pitch_average);
+        }
+
+        if (scores) {
+            scores[i] = score;
+        }
+        if (best < 0 || score > result.confidence) {
+            best = (int)i;
+            result.confidence = score;
+        }
+    }
+
+    if (best >= 0 && result.confidence >= match_threshold) {
+        result.index = best;
+    }
+    return result;
+}
+
+VoiceMatchResult voice_match_rows(const VoiceFeatures& probe, const SignatureMatrix& matrix,
+                                  const int16_t* rows, size_t count, float* scores) {
+    VoiceMatchResult result = {-1, 0.0f};
+
+    float probe_norm = signature_dot(probe.tone_signature, probe.tone_signature);
+    float inverse_probe = probe_norm > 0.0f ? 1.0f / sqrtf(probe_norm) : 0.0f;
+    int best = -1;
+
+    // Rows are contiguous and norms precomputed: one dot product per
+    // candidate, streaming through the matrix
+    for (size_t i = 0; i < count; i++) {
+        size_t row = rows ? (size_t)rows[i] : i;
+        const float* signature = matrix.signatures + row * VOICE_SIGNATURE_SIZE;
+        float cosine = signature_dot(probe.tone_signature, signature) * inverse_probe * matrix.inverse_norms[row];
+        float score = cosine != 0.0f ? combine_scores(cosine, probe.pitch_average, matrix.pitches[row]) : 0.0f;
+
+        if (scores) {
+            scores[i] = score;
+        }
+        if (best < 0 || score > result.confidence) {
+            best = (int)i;
+            result.confidence = score;
+        }
+    }
+
+    if (best >= 0 && result.confidence >= match_threshold) {
+        result.index = best;
+    }
+    return result;
+}
@@ -8,18 +8,12 @@
 // Voice processing and ElevenLabs integration
 #include "voice_processor.h"
 #include "error_handler.h"
+#include "storage_manager.h"
+#include "voice_matcher.h"
+#include "phonetic_index.h"
+#include "audio_codec.h"
 #include <cstring>
 
-struct VoiceProfile {
-    char keyword[32];
-    uint32_t voice_hash;
-    float pitch_average;
-    float tone_signature[8];
-    uint16_t assignment_number;
-    uint32_t timestamp;
-    bool active;
-};
-
 std::string get_elevenlabs_api_key() {
     const char* key = std::getenv("ELEVENLABS_API_KEY");
     if (key) return std::string(key);
@@ -43,9 +37,9 @@ void process_keyword(const char* keyword) {
 }
 
 // Register a new user (demo: only one profile)
-bool register_user(const char* keyword, uint32_t voice_hash) {
+bool register_user(const char* keyword, const VoiceFeatures& features) {
     log_entry("register_user");
-    if (strcmp(keyword, "Helsinki winter") == 0 && voice_hash == demo_profile.voice_hash) {
+    if (match_user(keyword, features) >= 0) {
         // Already registered
         log_exit("register_user");
         return false;
@@ -56,9 +50,16 @@ bool register_user(const char* keyword, uint32_t voice_hash) {
 }
 
 // Match user for retrieval
-int match_user(const char* keyword, uint32_t voice_hash) {
+int match_user(const char* keyword, const VoiceFeatures& features, float* confidence) {
     log_entry("match_user");
-    if (strcmp(keyword, demo_profile.keyword) == 0 && voice_hash == demo_profile.voice_hash) {
+    const VoiceProfile* candidates[] = {&demo_profile};
+    size_t count = keyword_similar(keyword, demo_profile.keyword) ? 1 : 0;
+
+    VoiceMatchResult result = voice_match_best(features, candidates, count);
+    if (confidence) {
+        *confidence = result.confidence;
+    }
+    if (result.index >= 0) {
         // Match found
         log_exit("match_user");
         return demo_profile.assignment_number;
@@ -70,9 +71,11 @@ int match_user(const char* keyword, uint32_t voice_hash) {
 
 
 // ElevenLabs API implementation for speech-to-text
-std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data) {
+std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data, AudioFormat upload_format) {
     log_entry("elevenlabs_speech_to_text");
     
+    std::string result = "";
+    
     std::string api_key = get_elevenlabs_api_key();
     if (api_key.empty()) {
         // For hackathon: hardcode your key here
@@ -80,15 +83,18 @@ std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data) {
     }
 
 #ifdef ESP32
+    // Upload time scales with bytes, so compress before it hits the air
+    std::vector<uint8_t> upload = audio_transcode_wav(audio_data, upload_format);
+    log_performance("STT_upload_bytes", (float)upload.size());
+    
     HTTPClient http;
     http.begin("https://api.elevenlabs.io/v1/speech-to-text");
     http.addHeader("Accept", "application/json");
     http.addHeader("xi-api-key", api_key.c_str());
     http.addHeader("Content-Type", "audio/wav");
     
-    int httpResponseCode = http.POST((uint8_t*)audio_data.data(), audio_data.size());
+    int httpResponseCode = http.POST(upload.data(), upload.size());
     
-    std::string result = "";
     if (httpResponseCode == 200) {
         String response = http.getString();
         
@@ -113,23 +119,52 @@ std::string elevenlabs_speech_to_text(const std::vector<uint8_t>& audio_data) {
     return result;
 }
 
-std::vector<uint8_t> elevenlabs_text_to_speech(const std::string& text) {
-    log_entry("elevenlabs_text_to_speech");
+#ifdef ESP32
+// Write-only Stream that forwards the decoded HTTP body to a sink;
+// HTTPClient::writeToStream() takes care of chunked transfer encoding
+class TtsSinkStream : public Stream {
+public:
+    explicit TtsSinkStream(const TtsAudioSink& sink) : total(0), rejected(false), sink(sink) {}
+    size_t write(const uint8_t* data, size_t length) override {
+        if (rejected || !sink(data, length)) {
+            rejected = true;
+            return 0;
+        }
+        total += length;
+        return length;
+    }
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+    size_t total;
+    bool rejected;
+private:
+    const TtsAudioSink& sink;
+};
+#endif
+
+bool elevenlabs_text_to_speech_stream(const std::string& text, const TtsAudioSink& sink) {
+    log_entry("elevenlabs_text_to_speech_stream");
     
     std::string api_key = get_elevenlabs_api_key();
     if (api_key.empty()) {
         api_key = "YOUR_ELEVENLABS_API_KEY_HERE"; // Hardcode for hackathon
     }
     
-    std::vector<uint8_t> audio_data;
+    bool success = false;
 
 #ifdef ESP32
+    // Raw PCM at the speaker rate: no decoder on the device, and every byte
+    // is playable the moment it arrives
     std::string voice_id = "21m00Tcm4TlvDq8ikWAM"; // Rachel voice
-    std::string url = "https://api.elevenlabs.io/v1/text-to-speech/" + voice_id;
+    std::string url = "https://api.elevenlabs.io/v1/text-to-speech/" + voice_id +
+                      "/stream?output_format=" + TTS_OUTPUT_FORMAT;
     
     HTTPClient http;
     http.begin(url.c_str());
-    http.addHeader("Accept", "audio/mpeg");
+    http.addHeader("Accept", "audio/pcm");
     http.addHeader("Content-Type", "application/json");
     http.addHeader("xi-api-key", api_key.c_str());
     
@@ -140,26 +175,34 @@ std::vector<uint8_t> elevenlabs_text_to_speech(const std::string& text) {
     int httpResponseCode = http.POST(json_payload);
     
     if (httpResponseCode == 200) {
-        WiFiClient* stream = http.getStreamPtr();
-        
-        // Read audio data
-        uint8_t buffer[512];
-        while (http.connected() && stream->available()) {
-            size_t bytes_read = stream->readBytes(buffer, sizeof(buffer));
-            audio_data.insert(audio_data.end(), buffer, buffer + bytes_read);
+        TtsSinkStream stream(sink);
+        int streamed = http.writeToStream(&stream);
+        if (streamed > 0 && !stream.rejected) {
+            success = true;
+            log_performance("TTS_success", 1.0f);
+        } else {
+            log_error(0x01, ("TTS stream failed: " + std::to_string(streamed)).c_str());
         }
-        
-        log_performance("TTS_success", 1.0f);
     } else {
         log_error(0x01, ("TTS API failed: " + std::to_string(httpResponseCode)).c_str());
     }
     http.end();
 #else
-    // Desktop simulation
-    audio_data.resize(1000, 0x80); // Dummy audio
+    // Desktop simulation: a short burst of silence
+    uint8_t silence[1000] = {0};
+    success = sink(silence, sizeof(silence));
     log_performance("TTS_simulation", 1.0f);
 #endif
 
-    log_exit("elevenlabs_text_to_speech");
+    log_exit("elevenlabs_text_to_speech_stream");
+    return success;
+}
+
+std::vector<uint8_t> elevenlabs_text_to_speech(const std::string& text) {
+    std::vector<uint8_t> audio_data;
+    elevenlabs_text_to_speech_stream(text, [&audio_data](const uint8_t* data, size_t length) {
+        audio_data.insert(audio_data.end(), data, data + length);
+        return true;
+    });
     return audio_data;
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+// RIFF/WAVE framing without intermediate copies
+#include "wav_writer.h"
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "wav_writer emits PCM in host byte order and requires a little-endian target"
+#endif
+
+static inline void put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static inline void put_le32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static inline uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void wav_write_header(uint8_t* header, uint32_t sample_rate, uint16_t channels,
+                      uint16_t bits_per_sample, uint32_t data_bytes) {
+    uint16_t block_align = channels * (bits_per_sample / 8);
+
+    // RIFF header
+    memcpy(header, "RIFF", 4);
+    memcpy(header + 8, "WAVE", 4);
+
+    // Format chunk
+    memcpy(header + 12, "fmt ", 4);
+    put_le32(header + 16, 16);          // Chunk size
+    put_le16(header + 20, 1);           // PCM format
+    put_le16(header + 22, channels);
+    put_le32(header + 24, sample_rate);
+    put_le32(header + 28, sample_rate * block_align); // Byte rate
+    put_le16(header + 32, block_align);
+    put_le16(header + 34, bits_per_sample);
+
+    // Data chunk
+    memcpy(header + 36, "data", 4);
+    wav_patch_sizes(header, data_bytes);
+}
+
+void wav_patch_sizes(uint8_t* header, uint32_t data_bytes) {
+    uint32_t riff_size = (data_bytes == WAV_STREAMING_SIZE) ? WAV_STREAMING_SIZE : data_bytes + 36;
+    put_le32(header + 4, riff_size);
+    put_le32(header + 40, data_bytes);
+}
+
+bool wav_find_data(const uint8_t* wav, size_t length, size_t* data_offset, size_t* data_bytes) {
+    if (length < 12 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    size_t offset = 12;
+    while (offset + 8 <= length) {
+        uint32_t chunk_size = get_le32(wav + offset + 4);
+        if (memcmp(wav + offset, "data", 4) == 0) {
+            size_t available = length - (offset + 8);
+            *data_offset = offset + 8;
+            *data_bytes = (chunk_size == WAV_STREAMING_SIZE || chunk_size > available) ? available : chunk_size;
+            return true;
+        }
+        // Chunks are padded to even sizes
+        offset += 8 + (size_t)chunk_size + (chunk_size & 1);
+    }
+    return false;
+}
+
+std::vector<uint8_t> wav_allocate(size_t max_samples) {
+    return std::vector<uint8_t>(WAV_HEADER_SIZE + max_samples * sizeof(int16_t));
+}
+
+void wav_finalize(std::vector<uint8_t>& wav, size_t samples, uint32_t sample_rate) {
+    uint32_t data_bytes = (uint32_t)(samples * sizeof(int16_t));
+    wav.resize(WAV_HEADER_SIZE + data_bytes);
+    wav_write_header(wav.data(), sample_rate, 1, 16, data_bytes);
+}
+
+WavStreamWriter::WavStreamWriter(WavSink sink, uint32_t sample_rate, uint16_t channels, uint16_t bits_per_sample)
+    : sink(sink), sample_rate(sample_rate), channels(channels), bits_per_sample(bits_per_sample),
+      data_bytes(0), started(false), error(false) {
+}
+
+bool WavStreamWriter::begin(uint32_t expected_data_bytes) {
+    uint8_t header[WAV_HEADER_SIZE];
+    wav_write_header(header, sample_rate, channels, bits_per_sample, expected_data_bytes);
+    data_bytes = 0;
+    started = true;
+    error = !sink(header, sizeof(header));
+    return !error;
+}
+
+bool WavStreamWriter::writeSamples(const int16_t* samples, size_t count) {
+    return write(reinterpret_cast<const uint8_t*>(samples), count * sizeof(int16_t));
+}
+
+bool WavStreamWriter::write(const uint8_t* data, size_t length) {
+    if (!started || error) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    if (!sink(data, length)) {
+        error = true;
+        return false;
+    }
+    data_bytes += length;
+    return true;
+}
+
+uint32_t WavStreamWriter::finish() {
+    started = false;
+    return data_bytes;
+}
+
+void WavStreamWriter::finalHeader(uint8_t* header) const {
+    wav_write_header(header, sample_rate, channels, bits_per_sample, data_bytes);
+}
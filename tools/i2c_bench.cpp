@@ -0,0 +1,190 @@
+// Host-side throughput and latency benchmark for the I2C protocol
+//
+// Runs the real transport (framing, ACK window, resends) between a
+// simulated AtomS3R and Feather over VirtualI2CBus, on simulated time, and
+// reports what a steady message load costs the bus. Each station has its
+// own AtomS3R-Feather bus, so one run sizes one station.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -Iinclude -Isrc -o i2c_bench tools/i2c_bench.cpp
+//       src/i2c_communication.cpp src/virtual_i2c_bus.cpp src/crc8.cpp
+//       src/error_handler.cpp -lpthread
+//
+// Usage:
+//   i2c_bench [--seconds 60] [--rate 20] [--payload 40] [--clock 100000]
+//             [--stretch-us 0] [--jitter-us 0] [--timeout-us 50000]
+//             [--nack 0] [--ber 0] [--seed 1]
+#include "i2c_communication.h"
+#include "virtual_i2c_bus.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#define BENCH_COMMAND 0x30
+
+struct BenchOptions {
+    double seconds;
+    double rate;                // messages offered per second
+    size_t payload;
+    VirtualI2CConfig bus;
+};
+
+struct BenchResults {
+    uint64_t offered;
+    uint64_t refused;           // send queue full
+    uint64_t delivered;
+    uint64_t failed;            // given up on by the transport
+    uint64_t received;          // messages the Feather drained
+    std::vector<uint64_t> latencies_us;
+};
+
+static void usage() {
+    fprintf(stderr,
+            "usage: i2c_bench [--seconds S] [--rate MSG/S] [--payload BYTES] [--clock HZ]\n"
+            "                 [--stretch-us US] [--jitter-us US] [--timeout-us US]\n"
+            "                 [--nack RATE] [--ber RATE] [--seed N]\n");
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    options->seconds = 60.0;
+    options->rate = 20.0;
+    options->payload = 40;
+    options->bus = virtual_i2c_default_config();
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* name = argv[i];
+        const char* value = argv[++i];
+        if (strcmp(name, "--seconds") == 0) {
+            options->seconds = atof(value);
+        } else if (strcmp(name, "--rate") == 0) {
+            options->rate = atof(value);
+        } else if (strcmp(name, "--payload") == 0) {
+            options->payload = (size_t)atoi(value);
+        } else if (strcmp(name, "--clock") == 0) {
+            options->bus.clock_hz = (uint32_t)atoi(value);
+        } else if (strcmp(name, "--stretch-us") == 0) {
+            options->bus.stretch_us = (uint32_t)atoi(value);
+        } else if (strcmp(name, "--jitter-us") == 0) {
+            options->bus.stretch_jitter_us = (uint32_t)atoi(value);
+        } else if (strcmp(name, "--timeout-us") == 0) {
+            options->bus.timeout_us = (uint32_t)atoi(value);
+        } else if (strcmp(name, "--nack") == 0) {
+            options->bus.nack_rate = atof(value);
+        } else if (strcmp(name, "--ber") == 0) {
+            options->bus.bit_error_rate = atof(value);
+        } else if (strcmp(name, "--seed") == 0) {
+            options->bus.seed = (uint32_t)atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return options->seconds > 0 && options->rate > 0 && options->payload <= I2C_BUFFER_SIZE &&
+           options->bus.clock_hz > 0;
+}
+
+static void run(const BenchOptions& options, VirtualI2CBus& bus, BenchResults* results) {
+    const uint64_t duration_us = (uint64_t)(options.seconds * 1e6);
+    const uint64_t tick_us = I2C_SERVICE_PERIOD_MS * 1000;
+    const double interval_us = 1e6 / options.rate;
+    double next_message_us = 0;
+    uint32_t counter = 0;
+
+    i2c_set_role(I2C_ROLE_PERIPHERAL);
+    i2c_begin_peripheral();
+    i2c_set_role(I2C_ROLE_CONTROLLER);
+    i2c_begin_controller();
+    i2c_attach_virtual_bus(&bus);
+
+    while (bus.nowUs() < duration_us) {
+        uint64_t now = bus.nowUs();
+        i2c_set_role(I2C_ROLE_CONTROLLER);
+        for (; next_message_us <= (double)now; next_message_us += interval_us) {
+            I2CMessage msg = {};
+            msg.command = BENCH_COMMAND;
+            msg.length = (uint8_t)options.payload;
+            for (size_t i = 0; i < options.payload; i++) {
+                msg.data[i] = (uint8_t)(counter + i);
+            }
+            counter++;
+            results->offered++;
+            uint64_t queued_us = (uint64_t)next_message_us;
+            bool queued = send_message(msg, [&bus, results, queued_us](bool delivered) {
+                if (delivered) {
+                    results->delivered++;
+                    results->latencies_us.push_back(bus.nowUs() - queued_us);
+                } else {
+                    results->failed++;
+                }
+            });
+            if (!queued) {
+                results->refused++;
+            }
+        }
+        i2c_service((uint32_t)(now / 1000));
+
+        i2c_set_role(I2C_ROLE_PERIPHERAL);
+        I2CMessage msg;
+        while (receive_message(msg)) {
+            results->received++;
+        }
+
+        // The bus task wakes on its period, or early for a new send
+        uint64_t next_tick = now - now % tick_us + tick_us;
+        bus.advanceTo(std::min(next_tick, (uint64_t)next_message_us));
+    }
+
+    i2c_attach_virtual_bus(nullptr);
+}
+
+static double percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage();
+        return 2;
+    }
+
+    // The transport logs every call; keep the report readable
+    std::cout.setstate(std::ios::badbit);
+
+    VirtualI2CBus bus(options.bus);
+    BenchResults results = {};
+    run(options, bus, &results);
+
+    const VirtualI2CStats& stats = bus.stats();
+    double seconds = bus.nowUs() / 1e6;
+    uint64_t frames = stats.writes + stats.reads - stats.nacks - stats.timeouts;
+    std::sort(results.latencies_us.begin(), results.latencies_us.end());
+
+    printf("bus          %u Hz, stretch %u+%u us, NACK %g, BER %g\n", options.bus.clock_hz,
+           options.bus.stretch_us, options.bus.stretch_jitter_us, options.bus.nack_rate,
+           options.bus.bit_error_rate);
+    printf("load         %.1f msg/s x %zu bytes for %.1f s\n", options.rate, options.payload, seconds);
+    printf("messages     offered %llu  delivered %llu  failed %llu  refused %llu  received %llu\n",
+           (unsigned long long)results.offered, (unsigned long long)results.delivered,
+           (unsigned long long)results.failed, (unsigned long long)results.refused,
+           (unsigned long long)results.received);
+    printf("frames/s     %.1f  (%llu writes, %llu reads, %llu NACKs, %llu timeouts)\n", frames / seconds,
+           (unsigned long long)stats.writes, (unsigned long long)stats.reads, (unsigned long long)stats.nacks,
+           (unsigned long long)stats.timeouts);
+    printf("bytes/s      %.1f  (%llu bits flipped)\n", stats.bytes / seconds,
+           (unsigned long long)stats.bits_flipped);
+    printf("bus busy     %.1f %%\n", 100.0 * stats.busy_us / bus.nowUs());
+    printf("latency ms   p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", percentile(results.latencies_us, 0.50),
+           percentile(results.latencies_us, 0.90), percentile(results.latencies_us, 0.99),
+           percentile(results.latencies_us, 1.0));
+    return 0;
+}
@@ -0,0 +1,446 @@
+// Host-side converter between SLPS profile snapshots and CSV/JSON
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -Iinclude -o snapshot_tool tools/snapshot_tool.cpp
+//       src/profile_snapshot.cpp src/profile_table.cpp src/keyword_index.cpp
+//       src/crc32.cpp src/error_handler.cpp
+//
+// Usage:
+//   snapshot_tool info   profiles.slps
+//   snapshot_tool export profiles.slps audit.csv|audit.json
+//   snapshot_tool import audit.csv|audit.json profiles.slps
+#include "profile_snapshot.h"
+#include "profile_table.h"
+#include "storage_manager.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool has_suffix(const std::string& text, const char* suffix) {
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static std::string csv_quote(const char* text) {
+    std::string out = "\"";
+    for (const char* p = text; *p; p++) {
+        if (*p == '"') {
+            out += '"';
+        }
+        out += *p;
+    }
+    return out + "\"";
+}
+
+static std::string json_quote(const char* text) {
+    std::string out = "\"";
+    for (const char* p = text; *p; p++) {
+        char c = *p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// ---- Export ----
+
+static bool export_csv(FILE* out, const ProfileTable& table, size_t rows) {
+    fprintf(out, "slot,active,assignment_number,keyword,voice_hash,timestamp,pitch_average,tone_signature\n");
+    VoiceProfile profile;
+    for (size_t slot = 0; slot < rows; slot++) {
+        table.load(slot, &profile);
+        fprintf(out, "%zu,%d,%u,%s,%u,%u,%.9g,", slot, profile.active ? 1 : 0, profile.assignment_number,
+                csv_quote(profile.keyword).c_str(), profile.voice_hash, profile.timestamp, profile.pitch_average);
+        for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+            fprintf(out, i ? " %.9g" : "%.9g", profile.tone_signature[i]);
+        }
+        fprintf(out, "\n");
+    }
+    return true;
+}
+
+static bool export_json(FILE* out, const ProfileTable& table, size_t rows) {
+    fprintf(out, "{\n  \"version\": %d,\n  \"rows\": %zu,\n  \"profiles\": [", PROFILE_SNAPSHOT_VERSION, rows);
+    VoiceProfile profile;
+    for (size_t slot = 0; slot < rows; slot++) {
+        table.load(slot, &profile);
+        fprintf(out, "%s\n    {\"slot\": %zu, \"active\": %s, \"assignment_number\": %u, \"keyword\": %s, "
+                     "\"voice_hash\": %u, \"timestamp\": %u, \"pitch_average\": %.9g, \"tone_signature\": [",
+                slot ? "," : "", slot, profile.active ? "true" : "false", profile.assignment_number,
+                json_quote(profile.keyword).c_str(), profile.voice_hash, profile.timestamp, profile.pitch_average);
+        for (int i = 0; i < VOICE_SIGNATURE_SIZE; i++) {
+            fprintf(out, i ? ", %.9g" : "%.9g", profile.tone_signature[i]);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    return true;
+}
+
+// ---- Import ----
+
+struct ImportedRow {
+    size_t slot;
+    VoiceProfile profile;
+};
+
+static void set_keyword(VoiceProfile& profile, const std::string& keyword) {
+    strncpy(profile.keyword, keyword.c_str(), sizeof(profile.keyword) - 1);
+    profile.keyword[sizeof(profile.keyword) - 1] = '\0';
+}
+
+static void parse_signature(VoiceProfile& profile, const std::string& text) {
+    std::istringstream values(text);
+    for (int i = 0; i < VOICE_SIGNATURE_SIZE && (values >> profile.tone_signature[i]); i++) {
+    }
+}
+
+// One CSV record; quoted fields may contain commas and doubled quotes
+static std::vector<std::string> csv_fields(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back() += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                fields.back() += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+static bool import_csv(const std::string& text, std::vector<ImportedRow>& rows) {
+    std::istringstream lines(text);
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(lines, line)) {
+        line_number++;
+        if (line_number == 1 || line.empty()) {
+            continue;   // header
+        }
+        std::vector<std::string> fields = csv_fields(line);
+        if (fields.size() != 8) {
+            fprintf(stderr, "line %zu: expected 8 fields, got %zu\n", line_number, fields.size());
+            return false;
+        }
+        ImportedRow row = {};
+        row.slot = strtoul(fields[0].c_str(), nullptr, 10);
+        row.profile.active = atoi(fields[1].c_str()) != 0;
+        row.profile.assignment_number = (uint16_t)strtoul(fields[2].c_str(), nullptr, 10);
+        set_keyword(row.profile, fields[3]);
+        row.profile.voice_hash = (uint32_t)strtoul(fields[4].c_str(), nullptr, 10);
+        row.profile.timestamp = (uint32_t)strtoul(fields[5].c_str(), nullptr, 10);
+        row.profile.pitch_average = strtof(fields[6].c_str(), nullptr);
+        parse_signature(row.profile, fields[7]);
+        rows.push_back(row);
+    }
+    return true;
+}
+
+// Just enough JSON for the export format: objects, arrays, strings,
+// numbers and booleans
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& source) : text(source), position(0) {}
+
+    bool failed() const { return error; }
+
+    void skipSpace() {
+        while (position < text.size() && isspace((unsigned char)text[position])) {
+            position++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (position < text.size() && text[position] == c) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail("unexpected character");
+        }
+    }
+
+    std::string string() {
+        std::string out;
+        expect('"');
+        while (!error && position < text.size() && text[position] != '"') {
+            char c = text[position++];
+            if (c == '\\' && position < text.size()) {
+                char escaped = text[position++];
+                if (escaped == 'u' && position + 4 <= text.size()) {
+                    out += (char)strtoul(text.substr(position, 4).c_str(), nullptr, 16);
+                    position += 4;
+                } else {
+                    out += escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped;
+                }
+            } else {
+                out += c;
+            }
+        }
+        expect('"');
+        return out;
+    }
+
+    double number() {
+        skipSpace();
+        const char* start = text.c_str() + position;
+        char* end;
+        double value = strtod(start, &end);
+        if (end == start) {
+            fail("expected a number");
+        }
+        position += end - start;
+        return value;
+    }
+
+    bool boolean() {
+        skipSpace();
+        if (text.compare(position, 4, "true") == 0) {
+            position += 4;
+            return true;
+        }
+        if (text.compare(position, 5, "false") == 0) {
+            position += 5;
+            return false;
+        }
+        fail("expected a boolean");
+        return false;
+    }
+
+    // Skips any value; used for keys this tool doesn't know
+    void skipValue() {
+        skipSpace();
+        if (position >= text.size()) {
+            fail("unexpected end");
+        } else if (text[position] == '"') {
+            string();
+        } else if (consume('[')) {
+            if (!consume(']')) {
+                do {
+                    skipValue();
+                } while (!error && consume(','));
+                expect(']');
+            }
+        } else if (consume('{')) {
+            if (!consume('}')) {
+                do {
+                    string();
+                    expect(':');
+                    skipValue();
+                } while (!error && consume(','));
+                expect('}');
+            }
+        } else if (text[position] == 't' || text[position] == 'f') {
+            boolean();
+        } else {
+            number();
+        }
+    }
+
+    void fail(const char* message) {
+        if (!error) {
+            fprintf(stderr, "JSON offset %zu: %s\n", position, message);
+        }
+        error = true;
+        position = text.size();
+    }
+
+private:
+    const std::string& text;
+    size_t position;
+    bool error = false;
+};
+
+static bool import_json(const std::string& text, std::vector<ImportedRow>& rows) {
+    JsonReader json(text);
+    json.expect('{');
+    bool found = false;
+    while (!json.failed() && !json.consume('}')) {
+        std::string key = json.string();
+        json.expect(':');
+        if (key != "profiles") {
+            json.skipValue();
+        } else {
+            found = true;
+            json.expect('[');
+            while (!json.failed() && !json.consume(']')) {
+                ImportedRow row = {};
+                json.expect('{');
+                while (!json.failed() && !json.consume('}')) {
+                    std::string field = json.string();
+                    json.expect(':');
+                    if (field == "slot") {
+                        row.slot = (size_t)json.number();
+                    } else if (field == "active") {
+                        row.profile.active = json.boolean();
+                    } else if (field == "assignment_number") {
+                        row.profile.assignment_number = (uint16_t)json.number();
+                    } else if (field == "keyword") {
+                        set_keyword(row.profile, json.string());
+                    } else if (field == "voice_hash") {
+                        row.profile.voice_hash = (uint32_t)json.number();
+                    } else if (field == "timestamp") {
+                        row.profile.timestamp = (uint32_t)json.number();
+                    } else if (field == "pitch_average") {
+                        row.profile.pitch_average = (float)json.number();
+                    } else if (field == "tone_signature") {
+                        json.expect('[');
+                        for (int i = 0; !json.failed() && !json.consume(']'); i++) {
+                            float value = (float)json.number();
+                            if (i < VOICE_SIGNATURE_SIZE) {
+                                row.profile.tone_signature[i] = value;
+                            }
+                            json.consume(',');
+                        }
+                    } else {
+                        json.skipValue();
+                    }
+                    json.consume(',');
+                }
+                rows.push_back(row);
+                json.consume(',');
+            }
+        }
+        json.consume(',');
+    }
+    if (!found && !json.failed()) {
+        fprintf(stderr, "no \"profiles\" array\n");
+    }
+    return found && !json.failed();
+}
+
+// ---- Commands ----
+
+static bool read_file(const char* path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return true;
+}
+
+static int command_info(const char* path) {
+    ProfileSnapshotInfo info;
+    ProfileTable table(MAX_PROFILES);
+    size_t rows = 0;
+    if (!profile_snapshot_verify(path, MAX_PROFILES, &info) || !profile_snapshot_read(path, table, &rows)) {
+        fprintf(stderr, "%s: not a valid snapshot\n", path);
+        return 1;
+    }
+    size_t active = 0;
+    for (size_t slot = 0; slot < rows; slot++) {
+        active += table.isActive(slot);
+    }
+    printf("version %u, %u rows (%zu active), %u columns, crc32 %08x\n",
+           info.version, info.rows, active, info.columns, info.crc);
+    return 0;
+}
+
+static int command_export(const char* snapshot_path, const char* out_path) {
+    ProfileSnapshotInfo info;
+    ProfileTable table(MAX_PROFILES);
+    size_t rows = 0;
+    if (!profile_snapshot_verify(snapshot_path, MAX_PROFILES, &info) ||
+        !profile_snapshot_read(snapshot_path, table, &rows)) {
+        fprintf(stderr, "%s: not a valid snapshot\n", snapshot_path);
+        return 1;
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "cannot create %s\n", out_path);
+        return 1;
+    }
+    bool ok = has_suffix(out_path, ".json") ? export_json(out, table, rows) : export_csv(out, table, rows);
+    ok = fclose(out) == 0 && ok;
+    printf("%zu rows written to %s\n", rows, out_path);
+    return ok ? 0 : 1;
+}
+
+static int command_import(const char* in_path, const char* snapshot_path) {
+    std::string text;
+    std::vector<ImportedRow> imported;
+    if (!read_file(in_path, text)) {
+        return 1;
+    }
+    bool ok = has_suffix(in_path, ".json") ? import_json(text, imported) : import_csv(text, imported);
+    if (!ok) {
+        return 1;
+    }
+
+    ProfileTable table(MAX_PROFILES);
+    size_t rows = 0;
+    for (const ImportedRow& row : imported) {
+        if (row.slot >= MAX_PROFILES) {
+            fprintf(stderr, "slot %zu out of range\n", row.slot);
+            return 1;
+        }
+        // store() derives the hash and norm columns
+        table.store(row.slot, row.profile);
+        if (row.slot + 1 > rows) {
+            rows = row.slot + 1;
+        }
+    }
+    if (!profile_snapshot_write(snapshot_path, table, rows)) {
+        fprintf(stderr, "cannot write %s\n", snapshot_path);
+        return 1;
+    }
+    printf("%zu rows written to %s\n", rows, snapshot_path);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // The snapshot code logs every call; keep the audit output clean
+    std::cout.setstate(std::ios::badbit);
+
+    if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return command_info(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "export") == 0) {
+        return command_export(argv[2], argv[3]);
+    }
+    if (argc == 4 && strcmp(argv[1], "import") == 0) {
+        return command_import(argv[2], argv[3]);
+    }
+    fprintf(stderr, "usage: %s info <snapshot.slps>\n"
+                    "       %s export <snapshot.slps> <out.csv|out.json>\n"
+                    "       %s import <in.csv|in.json> <snapshot.slps>\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+}